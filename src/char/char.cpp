@@ -21,14 +21,9 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-
-#include <sys/wait.h>
-
 #include <netdb.h>
 #include <unistd.h>
 
-#include <sys/resource.h>
-
 #include <cassert>
 #include <cstdlib>
 
@@ -36,7 +31,7 @@
 #include <array>
 #include <bitset>
 #include <chrono>
-#include <set>
+#include <memory>
 
 #include "../ints/cmp.hpp"
 #include "../ints/udl.hpp"
@@ -47,11 +42,13 @@
 #include "../strings/xstring.hpp"
 
 #include "../generic/array.hpp"
+#include "../generic/db.hpp"
 
+#include "../io/chunk.hpp"
 #include "../io/cxxstdio.hpp"
 #include "../io/extract.hpp"
 #include "../io/lock.hpp"
-#include "../io/read.hpp"
+#include "../io/mmap.hpp"
 #include "../io/span.hpp"
 #include "../io/tty.hpp"
 #include "../io/write.hpp"
@@ -74,6 +71,8 @@
 #include "../high/core.hpp"
 #include "../high/extract_mmo.hpp"
 #include "../high/mmo.hpp"
+#include "../high/save_thread.hpp"
+#include "../high/snapshot.hpp"
 #include "../high/utils.hpp"
 
 #include "../wire/packets.hpp"
@@ -110,6 +109,22 @@ void SessionDeleter::operator()(SessionData *sd)
 
 namespace char_
 {
+constexpr size_t CHAR_COMPACT_LINES = 4096;
+
+/// A character as stored in char_bin.
+struct NetCharPair
+{
+    NetCharKey key;
+    NetCharData data;
+};
+static_assert(alignof(NetCharPair) == 1, "alignof(NetCharPair) == 1");
+
+/// One line of char_txt, as parsed by a loader thread.
+struct CharLine
+{
+    enum { COMMENT, NEWID, DELETED, CHAR, BROKEN } kind;
+    CharPair cd;
+};
 
 auto iter_map_sessions() -> decltype(filter_iterator<Session *>(std::declval<Array<Session *, MAX_MAP_SERVERS> *>()))
 {
@@ -120,6 +135,8 @@ auto iter_map_sessions() -> decltype(filter_iterator<Session *>(std::declval<Arr
 
 static
 void create_online_files(void);
+static
+void set_offline_all(Session *ms);
 
 static
 void delete_tologin(Session *sess)
@@ -144,9 +161,7 @@ void delete_frommap(Session *sess)
             sess);
     server[id] = mmo_map_server{};
     server_session[id] = nullptr;
-    for (Session *& oci : online_chars)
-        if (oci == sess)
-            oci = nullptr;
+    set_offline_all(sess);
     create_online_files(); // update online players files (to remove all online players of this server)
 }
 
@@ -174,6 +189,32 @@ GmLevel isGM(AccountId account_id)
     return default_gm_level;
 }
 
+static
+CharPair *find_char_id(CharId char_id)
+{
+    Option<Borrowed<size_t>> idx = char_index_by_id.search(char_id);
+    OMATCH_BEGIN_SOME (i, idx)
+    {
+        return &char_keys[*i];
+    }
+    OMATCH_END ();
+    return nullptr;
+}
+
+//----------------------------------------------
+// Get a character's data to change it.
+//   A save that is still being written may share it;
+//   then it gets its own copy first, so the save
+//   keeps the character as it was when it was taken.
+//----------------------------------------------
+static
+CharData *char_edit(CharPair *cp)
+{
+    if (cp->data.use_count() > 1)
+        cp->data = std::make_shared<CharData>(*cp->data);
+    return cp->data.get();
+}
+
 //----------------------------------------------
 // Search an character id
 //   (return character pointer or nullptr (if not found))
@@ -184,56 +225,165 @@ GmLevel isGM(AccountId account_id)
 //----------------------------------------------
 const CharPair *search_character(CharName character_name)
 {
-    for (const CharPair& cd : char_keys)
+    Option<Borrowed<CharId>> cid = char_index_by_name.search(character_name);
+    OMATCH_BEGIN_SOME (c, cid)
     {
-        {
-            // Strict comparison (if found, we finish the function immediatly with correct value)
-            if (cd.key.name == character_name)
-                return &cd;
-        }
+        return find_char_id(*c);
     }
-
-    // Exact character name is not found and 0 or more than 1 similar characters have been found ==> we say not found
+    OMATCH_END ();
     return nullptr;
 }
 
 const CharPair *search_character_id(CharId char_id)
 {
-    for (const CharPair& cd : char_keys)
+    return find_char_id(char_id);
+}
+
+/// The characters of an account, in no particular order.
+static
+std::vector<CharPair *> chars_of_account(AccountId account_id)
+{
+    std::vector<CharPair *> rv;
+    Option<Borrowed<std::vector<CharId>>> cids = char_index_by_account.search(account_id);
+    OMATCH_BEGIN_SOME (v, cids)
     {
-        if (cd.key.char_id == char_id)
-            return &cd;
+        for (CharId cid : *v)
+            rv.push_back(find_char_id(cid));
     }
+    OMATCH_END ();
+    return rv;
+}
 
-    return nullptr;
+//----------------------------------------------
+// Index the character at char_keys[idx].
+// If a name or id is duplicated in the file, the first one wins,
+// the same as when these were found by a linear search.
+//----------------------------------------------
+static
+void char_index_add(size_t idx)
+{
+    const CharKey& k = char_keys[idx].key;
+    if (char_index_by_id.search(k.char_id).is_some())
+        return;
+    char_index_by_id.insert(k.char_id, idx);
+    if (char_index_by_name.search(k.name).is_none())
+        char_index_by_name.insert(k.name, k.char_id);
+    char_index_by_account.init(k.account_id)->push_back(k.char_id);
+}
+
+static
+void char_index_remove(const CharKey& k)
+{
+    Option<Borrowed<size_t>> idx = char_index_by_id.search(k.char_id);
+    OMATCH_BEGIN_SOME (i, idx)
+    {
+        if (&char_keys[*i].key != &k)
+            return;
+    }
+    OMATCH_END ();
+    char_index_by_id.erase(k.char_id);
+
+    Option<Borrowed<CharId>> cid = char_index_by_name.search(k.name);
+    OMATCH_BEGIN_SOME (c, cid)
+    {
+        if (*c == k.char_id)
+            char_index_by_name.erase(k.name);
+    }
+    OMATCH_END ();
+
+    Option<Borrowed<std::vector<CharId>>> cids = char_index_by_account.search(k.account_id);
+    OMATCH_BEGIN_SOME (v, cids)
+    {
+        v->erase(std::remove(v->begin(), v->end(), k.char_id), v->end());
+        if (v->empty())
+            char_index_by_account.erase(k.account_id);
+    }
+    OMATCH_END ();
+}
+
+//----------------------------------------------
+// Remove a character from char_keys.
+// This moves the last character into its place, so it
+// invalidates pointers to that one too.
+//----------------------------------------------
+static
+void char_erase(CharPair *cp)
+{
+    size_t idx = cp - &char_keys.front();
+    char_dirty.insert(cp->key.char_id);
+    online_chars.erase(cp->key.char_id);
+    char_index_remove(cp->key);
+    if (cp != &char_keys.back())
+    {
+        CharPair& last = char_keys.back();
+        Option<Borrowed<size_t>> last_idx = char_index_by_id.search(last.key.char_id);
+        OMATCH_BEGIN_SOME (i, last_idx)
+        {
+            if (*i == char_keys.size() - 1)
+                *i = idx;
+        }
+        OMATCH_END ();
+        std::swap(*cp, last);
+    }
+    char_keys.pop_back();
+}
+
+//----------------------------------------------
+// Replace a character's key, as the map server may rename it.
+//----------------------------------------------
+static
+void char_rekey(CharPair *cp, const CharKey& key)
+{
+    char_dirty.insert(cp->key.char_id);
+    // every save carries the key, but it hardly ever changes
+    if (cp->key.name == key.name && cp->key.account_id == key.account_id
+            && cp->key.char_id == key.char_id && cp->key.char_num == key.char_num)
+        return;
+    size_t idx = cp - &char_keys.front();
+    char_dirty.insert(key.char_id);
+    char_index_remove(cp->key);
+    cp->key = key;
+    char_index_add(idx);
 }
 
-// TODO make these DIE already
 Session *server_for(const CharPair *mcs)
 {
     if (!mcs)
         return nullptr;
-    return online_chars[mcs - &char_keys.front()];
+    Option<Borrowed<Session *>> sess = online_chars.search(mcs->key.char_id);
+    OMATCH_BEGIN_SOME (ss, sess)
+    {
+        return *ss;
+    }
+    OMATCH_END ();
+    return nullptr;
 }
+
+//----------------------------------------------
+// Forget which characters are online on a map server.
+//----------------------------------------------
 static
-Session *& server_for_m(const CharPair *mcs)
+void set_offline_all(Session *ms)
 {
-    return online_chars[mcs - &char_keys.front()];
+    std::vector<CharId> gone;
+    for (auto& pair : online_chars)
+        if (pair.second == ms)
+            gone.push_back(pair.first);
+    for (CharId cid : gone)
+        online_chars.erase(cid);
 }
 
 //-------------------------------------------------
 // Function to create the character line (for save)
 //-------------------------------------------------
 static
-AString mmo_char_tostr(struct CharPair *cp)
+AString mmo_char_tostr(const CharPair *cp)
 {
-    CharKey *k = &cp->key;
-    CharData *p = cp->data.get();
+    const CharKey *k = &cp->key;
+    const CharData *p = cp->data.get();
     // on multi-map server, sometimes it's posssible that last_point become void. (reason???) We check that to not lost character at restart.
-    if (!p->last_point.map_)
-    {
-        p->last_point = char_conf.start_point;
-    }
+    const Point& last_point = p->last_point.map_
+        ? p->last_point : char_conf.start_point;
 
     MString str_p;
     str_p += STRPRINTF(
@@ -263,7 +413,7 @@ AString mmo_char_tostr(struct CharPair *cp)
             p->party_id, 0/*guild_id*/, 0/*pet_id*/,
             p->hair, p->hair_color, p->clothes_color,
             p->weapon, p->shield, p->head_top, p->head_mid, p->head_bottom,
-            p->last_point.map_, p->last_point.x, p->last_point.y,
+            last_point.map_, last_point.x, last_point.y,
             p->save_point.map_, p->save_point.x, p->save_point.y, p->partner_id);
 
     // memos were here (no longer supported)
@@ -394,20 +544,8 @@ bool impl_extract(XString str, CharPair *cp)
     if (WISP_SERVER_NAME == k->name)
         return false;
 
-    // TODO replace *every* lookup with a map lookup
-    static std::set<CharId> seen_ids;
-    static std::set<CharName> seen_names;
-    // we don't have to worry about deleted characters,
-    // this is only called during startup
-    auto _seen_id = seen_ids.insert(k->char_id);
-    if (!_seen_id.second)
-        return false;
-    auto _seen_name = seen_names.insert(k->name);
-    if (!_seen_name.second)
-    {
-        seen_ids.erase(_seen_id.first);
-        return false;
-    }
+    // duplicate ids and names are caught by mmo_char_init,
+    // since this runs on several lines at once
 
     // memos were here - no longer supported
 
@@ -443,10 +581,44 @@ static
 int mmo_char_init(void)
 {
     char_keys.clear();
+    char_index_by_id.clear();
+    char_index_by_name.clear();
+    char_index_by_account.clear();
     online_chars.clear();
 
-    io::ReadFile in(char_conf.char_txt);
-    if (!in.is_open())
+    SnapshotReader snap(char_conf.char_bin, char_conf.char_txt, snapshot_load,
+            "char"_s, sizeof(NetCharPair));
+    if (snapshot_load == SnapshotLoad::SNAPSHOT && !snap.is_open())
+        snapshot_missing = true;
+    size_t record_count = 0;
+    if (snap.is_open())
+    {
+        char_keys.reserve(snap.size());
+        char_index_by_id.reserve(snap.size());
+        char_index_by_name.reserve(snap.size());
+        for (size_t i = 0; i < snap.size(); ++i)
+        {
+            const NetCharPair& net = snap.get<NetCharPair>(i);
+            CharPair cd;
+            if (!network_to_native(&cd.key, net.key)
+                    || !network_to_native(cd.data.get(), net.data)
+                    || find_char_id(cd.key.char_id))
+            {
+                CHAR_LOG("Char %zu skipped in %s\n"_fmt, i, char_conf.char_bin);
+                continue;
+            }
+            char_keys.push_back(std::move(cd));
+            char_index_add(char_keys.size() - 1);
+        }
+        record_count = char_keys.size();
+        if (char_id_count < wrap<CharId>(snap.next_id()))
+            char_id_count = wrap<CharId>(snap.next_id());
+        PRINTF("mmo_char_init: %zu characters read in %s.\n"_fmt,
+                char_keys.size(), char_conf.char_bin);
+    }
+
+    io::MappedFile text(char_conf.char_txt);
+    if (!text.is_open() && !snap.is_open())
     {
         PRINTF("Characters file not found: %s.\n"_fmt, char_conf.char_txt);
         CHAR_LOG("Characters file not found: %s.\n"_fmt, char_conf.char_txt);
@@ -455,36 +627,66 @@ int mmo_char_init(void)
         return 0;
     }
 
-    int line_count = 0;
-    AString line;
-    while (in.getline(line))
-    {
-        line_count++;
-
-        if (is_comment(line))
-            continue;
-
-        {
-            CharId i;
-            if (extract(line, record<'\t'>(&i, "%newid%"_s)))
+    // Characters saved since the file was last rewritten are appended
+    // to it, so a later line for the same char id replaces an earlier
+    // one, and a "%deleted%" line removes it.
+    io::parse_lines<CharLine>(snap.text_tail(text),
+            [](XString line, CharLine *cl)
             {
-                if (char_id_count < i)
-                    char_id_count = i;
-                continue;
-            }
-        }
-
-        CharPair cd;
-        if (!extract(line, &cd))
-        {
-            CHAR_LOG("Char skipped\n%s"_fmt, line);
-            continue;
-        }
-        if (char_id_count < next(cd.key.char_id))
-            char_id_count = next(cd.key.char_id);
-        char_keys.push_back(std::move(cd));
-        online_chars.push_back(nullptr);
-    }
+                if (is_comment(line))
+                    cl->kind = CharLine::COMMENT;
+                else if (extract(line, record<'\t'>(&cl->cd.key.char_id, "%newid%"_s)))
+                    cl->kind = CharLine::NEWID;
+                else if (extract(line, record<'\t'>(&cl->cd.key.char_id, "%deleted%"_s)))
+                    cl->kind = CharLine::DELETED;
+                else if (extract(line, &cl->cd))
+                    cl->kind = CharLine::CHAR;
+                else
+                    cl->kind = CharLine::BROKEN;
+            },
+            [&record_count](XString line, CharLine& cl)
+            {
+                CharId i = cl.cd.key.char_id;
+                CharPair *cp = nullptr;
+                switch (cl.kind)
+                {
+                case CharLine::COMMENT:
+                    return;
+                case CharLine::NEWID:
+                    if (char_id_count < i)
+                        char_id_count = i;
+                    return;
+                case CharLine::DELETED:
+                    record_count++;
+                    if (char_id_count < next(i))
+                        char_id_count = next(i);
+                    if ((cp = find_char_id(i)))
+                        char_erase(cp);
+                    return;
+                case CharLine::CHAR:
+                    cp = find_char_id(i);
+                    if (!char_index_by_name.search(cl.cd.key.name).is_none()
+                            && !(cp && cp->key.name == cl.cd.key.name))
+                        break;
+                    record_count++;
+                    if (char_id_count < next(i))
+                        char_id_count = next(i);
+                    if (cp)
+                    {
+                        char_rekey(cp, cl.cd.key);
+                        cp->data = std::move(cl.cd.data);
+                        return;
+                    }
+                    char_keys.push_back(std::move(cl.cd));
+                    char_index_add(char_keys.size() - 1);
+                    return;
+                case CharLine::BROKEN:
+                    break;
+                }
+                CHAR_LOG("Char skipped\n%s"_fmt, AString(line));
+            });
+    char_journal_lines = record_count - char_keys.size();
+    char_dirty.clear();
 
     PRINTF("mmo_char_init: %zu characters read in %s.\n"_fmt,
             char_keys.size(), char_conf.char_txt);
@@ -501,60 +703,168 @@ int mmo_char_init(void)
 // Function to save characters in files (speed up by [Yor])
 //---------------------------------------------------------
 static
-void mmo_char_sync(void)
+bool mmo_char_sync(const std::vector<CharPair>& chars, CharId next_id, uint64_t *bytes)
 {
-    io::WriteLock fp(char_conf.char_txt);
-    if (!fp.is_open())
+    {
+        io::WriteLock fp(char_conf.char_txt);
+        if (!fp.is_open())
+        {
+            PRINTF("WARNING: Server can't not save characters.\n"_fmt);
+            return false;
+        }
+        for (const CharPair& cd : chars)
+        {
+            AString line = mmo_char_tostr(&cd);
+            fp.put_line(line);
+        }
+        FPRINTF(fp, "%d\t%%newid%%\n"_fmt, next_id);
+        *bytes += fp.written();
+        if (!fp.close())
+        {
+            PRINTF("WARNING: Server can't not save characters.\n"_fmt);
+            return false;
+        }
+    }
+
+    if (!char_conf.char_bin)
+        return true;
+    SnapshotWriter snap(char_conf.char_bin, char_conf.char_txt,
+            "char"_s, sizeof(NetCharPair), unwrap<CharId>(next_id));
+    if (!snap.is_open())
     {
         PRINTF("WARNING: Server can't not save characters.\n"_fmt);
-        CHAR_LOG("WARNING: Server can't not save characters.\n"_fmt);
-        return;
+        return false;
     }
+    for (const CharPair& cd : chars)
     {
-        // yes, we need a mutable reference to do the saves ...
-        for (CharPair& cd : char_keys)
+        NetCharPair net;
+        if (!native_to_network(&net.key, cd.key)
+                || !native_to_network(&net.data, *cd.data))
         {
-            AString line = mmo_char_tostr(&cd);
-            fp.put_line(line);
+            // leaving it out would lose it on the next load
+            PRINTF("WARNING: character %d can't go in %s, not writing it.\n"_fmt,
+                    cd.key.char_id, char_conf.char_bin);
+            snap.abandon();
+            return true;
         }
-        FPRINTF(fp, "%d\t%%newid%%\n"_fmt, char_id_count);
+        snap.put(net);
+    }
+    *bytes += snap.written();
+    if (!snap.close())
+    {
+        PRINTF("WARNING: Server can't not save characters.\n"_fmt);
+        return false;
     }
+    return true;
 }
 
+//---------------------------------------------------------
+// Append just the characters changed since the last save,
+// and make sure they are on disk before returning.
+//---------------------------------------------------------
+static
+bool mmo_char_append(const std::vector<CharPair>& chars, const std::vector<CharId>& deleted,
+        uint64_t *bytes)
+{
+    if (chars.empty() && deleted.empty())
+        return true;
+    io::AppendFile fp(char_conf.char_txt);
+    if (!fp.is_open())
+    {
+        PRINTF("WARNING: Server can't not save characters.\n"_fmt);
+        return false;
+    }
+    for (const CharPair& cd : chars)
+        fp.put_line(mmo_char_tostr(&cd));
+    for (CharId cid : deleted)
+        FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, cid);
+    *bytes += fp.written();
+    if (!fp.sync())
+    {
+        PRINTF("WARNING: Server can't not save characters.\n"_fmt);
+        return false;
+    }
+    return true;
+}
+
+/// What one periodic save writes, taken from the live tables.
+struct CharSave
+{
+    bool compact;
+    // every character if compact, else just the changed ones;
+    // the data is shared with char_keys until char_edit() copies it
+    std::vector<CharPair> chars;
+    std::vector<CharId> deleted;
+    CharId next_id;
+    SaveThread::Job inter;
+};
+
 //----------------------------------------------------
 // Function to save (in a periodic way) datas in files
 //----------------------------------------------------
 static
 void mmo_char_sync_timer(TimerData *, tick_t)
 {
-    if (pid != 0)
+    bool failed = false;
+    SaveReport report;
+    if (save_thread.finished(&report))
     {
-        int status;
-        pid_t temp = waitpid(pid, &status, WNOHANG);
+        failed = !report.ok;
+        CHAR_LOG("Saved %s%zu bytes: copy took %dus, on disk %dms later.\n"_fmt,
+                failed ? "(with errors) "_s : ""_s,
+                static_cast<size_t>(report.bytes_written),
+                static_cast<int>(report.snapshot_time.count()),
+                static_cast<int>(report.save_lag.count()));
+        // Only now are the saved changes known to be on disk.
+        if (failed)
+            char_dirty.insert(char_saving.begin(), char_saving.end());
+        else
+            char_journal_lines = char_saving_lines;
+        char_saving.clear();
+        inter_saved(!failed);
+    }
+    // The changes keep piling up in char_dirty until it is done.
+    if (save_thread.busy())
+        return;
 
-        // Need to check status too?
-        if (temp == 0)
+    save_clock::time_point start = save_clock::now();
+
+    // Usually only the changed characters need to be appended. Once the
+    // appended lines outnumber the characters (or CHAR_COMPACT_LINES,
+    // whichever is more), or if the last save failed, the whole file
+    // is rewritten instead.
+    std::shared_ptr<CharSave> save = std::make_shared<CharSave>();
+    char_saving.swap(char_dirty);
+    save->compact = failed || char_journal_lines + char_saving.size()
+        > std::max(CHAR_COMPACT_LINES, char_keys.size());
+    if (save->compact)
+    {
+        save->chars = char_keys;
+        char_saving_lines = 0;
+    }
+    else
+    {
+        for (CharId cid : char_saving)
         {
-            return;
+            if (CharPair *cp = find_char_id(cid))
+                save->chars.push_back(*cp);
+            else
+                save->deleted.push_back(cid);
         }
+        char_saving_lines = char_journal_lines + char_saving.size();
     }
+    save->next_id = char_id_count;
+    save->inter = inter_snapshot(failed);
 
-    // This can take a lot of time. Fork a child to handle the work and return at once
-    // If we're unable to fork just continue running the function normally
-    if ((pid = fork()) > 0) {
-        return;
-    }
-
-    // If we're a child, run as a lower priority process
-    if (pid == 0)
-        setpriority(PRIO_PROCESS, getpid(), 10);
-
-    mmo_char_sync();
-    inter_save();
-
-    // If we're a child we should suicide now.
-    if (pid == 0)
-        _exit(0);
+    save_thread.save(
+            [save](uint64_t *bytes)
+            {
+                bool ok = save->compact
+                    ? mmo_char_sync(save->chars, save->next_id, bytes)
+                    : mmo_char_append(save->chars, save->deleted, bytes);
+                return save->inter(bytes) && ok;
+            },
+            start);
 }
 
 //-----------------------------------
@@ -634,19 +944,19 @@ CharPair *make_new_char(Session *s, CharName name, const Stats6& stats, uint8_t
         }
     }
 
-    for (const CharPair& cd : char_keys)
+    if (const CharPair *other = search_character(name))
     {
-        if (cd.key.name == name)
-        {
-            CHAR_LOG("Make new char error (name already exists): (connection #%d, account: %d) slot %d, name: %s (actual name of other char: %s), stats: %d+%d+%d+%d+%d+%d=%d, hair: %d, hair color: %d.\n"_fmt,
-                    s, sd->account_id, slot, name, cd.key.name,
-                    stats.str, stats.agi, stats.vit, stats.int_, stats.dex, stats.luk,
-                    stats.str + stats.agi + stats.vit + stats.int_ + stats.dex + stats.luk,
-                    hair_style, hair_color);
-            return nullptr;
-        }
-        if (cd.key.account_id == sd->account_id
-            && cd.key.char_num == slot)
+        CHAR_LOG("Make new char error (name already exists): (connection #%d, account: %d) slot %d, name: %s (actual name of other char: %s), stats: %d+%d+%d+%d+%d+%d=%d, hair: %d, hair color: %d.\n"_fmt,
+                s, sd->account_id, slot, name, other->key.name,
+                stats.str, stats.agi, stats.vit, stats.int_, stats.dex, stats.luk,
+                stats.str + stats.agi + stats.vit + stats.int_ + stats.dex + stats.luk,
+                hair_style, hair_color);
+        return nullptr;
+    }
+    for (const CharPair *other : chars_of_account(sd->account_id))
+    {
+        const CharPair& cd = *other;
+        if (cd.key.char_num == slot)
         {
             CHAR_LOG("Make new char error (slot already used): (connection #%d, account: %d) slot %d, name: %s (actual name of other char: %s), stats: %d+%d+%d+%d+%d+%d=%d, hair: %d, hair color: %d.\n"_fmt,
                     s, sd->account_id, slot, name, cd.key.name,
@@ -717,8 +1027,9 @@ CharPair *make_new_char(Session *s, CharName name, const Stats6& stats, uint8_t
     cd.head_bottom = ItemNameId();
     cd.last_point = char_conf.start_point;
     cd.save_point = char_conf.start_point;
+    char_dirty.insert(cp.key.char_id);
     char_keys.push_back(std::move(cp));
-    online_chars.push_back(nullptr);
+    char_index_add(char_keys.size() - 1);
 
     return &char_keys.back();
 }
@@ -773,11 +1084,21 @@ void create_online_files(void)
                     FPRINTF(fp, "-"_fmt);
                 FPRINTF(fp, "\n"_fmt);
 
-                // display each player.
-                for (CharPair& cd : char_keys)
+                // display each player, in the order they are in char_keys
+                std::vector<size_t> online_idx;
+                for (auto& pair : online_chars)
                 {
-                    if (!server_for(&cd))
-                        continue;
+                    Option<Borrowed<size_t>> idx = char_index_by_id.search(pair.first);
+                    OMATCH_BEGIN_SOME (i, idx)
+                    {
+                        online_idx.push_back(*i);
+                    }
+                    OMATCH_END ();
+                }
+                std::sort(online_idx.begin(), online_idx.end());
+                for (size_t i : online_idx)
+                {
+                    const CharPair& cd = char_keys[i];
                     players++;
                     FPRINTF(fp2, "      <tr>\n"_fmt);
                     // displaying the character name
@@ -868,7 +1189,7 @@ int count_users(void)
 static
 ItemNameId find_equip_view(const CharPair *cp, EPOS equipmask)
 {
-    CharData *p = cp->data.get();
+    const CharData *p = cp->data.get();
     for (IOff0 i : IOff0::iter())
     {
         if (p->inventory[i].nameid && p->inventory[i].amount
@@ -888,15 +1209,12 @@ int mmo_char_send006b(Session *s, struct char_session_data *sd)
 {
     int found_num = 0;
     std::array<const CharPair *, 9> found_char;
-    for (const CharPair& cd : char_keys)
+    for (const CharPair *cp : chars_of_account(sd->account_id))
     {
-        if (cd.key.account_id == sd->account_id)
-        {
-            found_char[found_num] = &cd;
-            found_num++;
-            if (found_num == 9)
-                break;
-        }
+        found_char[found_num] = cp;
+        found_num++;
+        if (found_num == 9)
+            break;
     }
 
     Packet_Head<0x006b> head_6b;
@@ -972,17 +1290,15 @@ int set_account_reg2(AccountId acc, Slice<GlobalReg> reg)
     size_t num = reg.size();
     assert (num < ACCOUNT_REG2_NUM);
     int c = 0;
-    for (CharPair& cd : char_keys)
+    for (CharPair *cp : chars_of_account(acc))
     {
-        if (cd.key.account_id == acc)
-        {
-            for (int i = 0; i < num; ++i)
-                cd.data->account_reg2[i] = reg[i];
-            cd.data->account_reg2_num = num;
-            for (int i = num; i < ACCOUNT_REG2_NUM; ++i)
-                cd.data->account_reg2[i] = GlobalReg{};
-            c++;
-        }
+        CharData *cd = char_edit(cp);
+        std::copy(reg.begin(), reg.end(), cd->account_reg2.begin());
+        cd->account_reg2_num = num;
+        for (int i = num; i < ACCOUNT_REG2_NUM; ++i)
+            cd->account_reg2[i] = GlobalReg{};
+        char_dirty.insert(cp->key.char_id);
+        c++;
     }
     return c;
 }
@@ -1009,14 +1325,15 @@ int char_divorce(CharPair *cp)
         }
         return 0;
     }
+    cs = char_edit(cp);
 
     Packet_Fixed<0x2b12> fixed_12;
     fixed_12.char_id = ck->char_id;
 
-    for (CharPair& cd : char_keys)
+    if (CharPair *partner = find_char_id(cs->partner_id))
     {
-        if (cd.key.char_id == cs->partner_id
-            && cd.data->partner_id == ck->char_id)
+        CharPair& cd = *partner;
+        if (cd.data->partner_id == ck->char_id)
         {
             fixed_12.partner_id = cs->partner_id;
             for (Session *ss : iter_map_sessions())
@@ -1025,12 +1342,14 @@ int char_divorce(CharPair *cp)
             }
 
             cs->partner_id = CharId();
-            cd.data->partner_id = CharId();
+            char_edit(&cd)->partner_id = CharId();
+            char_dirty.insert(ck->char_id);
+            char_dirty.insert(cd.key.char_id);
             return 0;
         }
         // The other char doesn't have us as their partner, so just clear our partner
         // Don't worry about this, as the map server should verify itself that the other doesn't have us as a partner, and so won't mess with their marriage
-        else if (cd.key.char_id == cs->partner_id)
+        else
         {
             fixed_12.partner_id = cs->partner_id;
             for (Session *ss : iter_map_sessions())
@@ -1039,6 +1358,7 @@ int char_divorce(CharPair *cp)
             }
 
             cs->partner_id = CharId();
+            char_dirty.insert(ck->char_id);
             return 0;
         }
     }
@@ -1046,6 +1366,7 @@ int char_divorce(CharPair *cp)
     // Our partner wasn't found, so just clear our marriage
     fixed_12.partner_id = cs->partner_id;
     cs->partner_id = CharId();
+    char_dirty.insert(ck->char_id);
     for (Session *ss : iter_map_sessions())
     {
         send_fpacket<0x2b12, 10>(ss, fixed_12);
@@ -1083,7 +1404,7 @@ static
 int char_delete(CharPair *cp)
 {
     CharKey *ck = &cp->key;
-    CharData *cs = cp->data.get();
+    const CharData *cs = cp->data.get();
 
     // パーティー脱退
     if (cs->party_id)
@@ -1257,27 +1578,24 @@ void parse_tologin(Session *ls)
                     SEX sex = fixed.sex;
                     if (acc)
                     {
-                        for (CharPair& cp : char_keys)
+                        for (CharPair *cp : chars_of_account(acc))
                         {
-                            CharKey& ck = cp.key;
-                            CharData& cd = *cp.data;
-                            if (ck.account_id == acc)
-                            {
-                                cd.sex = sex;
+                            CharData& cd = *char_edit(cp);
+                            cd.sex = sex;
+                            char_dirty.insert(cp->key.char_id);
 //                      auth_fifo[i].sex = sex;
-                                // to avoid any problem with equipment and invalid sex, equipment is unequiped.
-                                for (IOff0 j : IOff0::iter())
-                                {
-                                    if (cd.inventory[j].nameid
-                                        && bool(cd.inventory[j].equip))
-                                        cd.inventory[j].equip = EPOS::ZERO;
-                                }
-                                cd.weapon = ItemLook::NONE;
-                                cd.shield = ItemNameId();
-                                cd.head_top = ItemNameId();
-                                cd.head_mid = ItemNameId();
-                                cd.head_bottom = ItemNameId();
+                            // to avoid any problem with equipment and invalid sex, equipment is unequiped.
+                            for (IOff0 j : IOff0::iter())
+                            {
+                                if (cd.inventory[j].nameid
+                                    && bool(cd.inventory[j].equip))
+                                    cd.inventory[j].equip = EPOS::ZERO;
                             }
+                            cd.weapon = ItemLook::NONE;
+                            cd.shield = ItemNameId();
+                            cd.head_top = ItemNameId();
+                            cd.head_mid = ItemNameId();
+                            cd.head_bottom = ItemNameId();
                         }
                         // disconnect player if online on char-server
                         disconnect_player(acc);
@@ -1384,28 +1702,15 @@ void parse_tologin(Session *ls)
                 AccountId aid = fixed.account_id;
 
                 // Deletion of all characters of the account
-//#warning "This comment is a lie, but it's still true."
-                // needs to use index because they may move during resize
-                for (int idx = 0; idx < char_keys.size(); idx++)
+                // by id, because char_erase() moves them around
                 {
-                    CharPair& cp = char_keys[idx];
-                    CharKey& ck = cp.key;
-                    if (ck.account_id == aid)
+                    std::vector<CharId> cids;
+                    for (CharPair *cp : chars_of_account(aid))
+                        cids.push_back(cp->key.char_id);
+                    for (CharId cid : cids)
                     {
-                        char_delete(&cp);
-                        if (&cp != &char_keys.back())
-                        {
-                            std::swap(cp, char_keys.back());
-                            // if moved character owns to deleted account, check again it's character
-                            // YES this is the newly swapped one
-                            // we could avoid this by working backwards
-                            if (ck.account_id == aid)
-                            {
-                                idx--;
-                                // Correct moved character reference in the character's owner by [Yor]
-                            }
-                        }
-                        char_keys.pop_back();
+                        char_delete(find_char_id(cid));
+                        char_erase(find_char_id(cid));
                     }
                 }
                 // Deletion of the storage
@@ -1676,25 +1981,18 @@ void parse_frommap(Session *ms)
                         afi.ip == ip
                         && !afi.delflag)
                     {
-                        CharPair *cp = nullptr;
-                        for (CharPair& cdi : char_keys)
-                        {
-                            if (cdi.key.char_id == afi.char_id)
-                            {
-                                cp = &cdi;
-                                break;
-                            }
-                        }
+                        CharPair *cp = find_char_id(afi.char_id);
                         assert (cp && "uh-oh - deleted while in queue?"_s);
 
                         CharKey *ck = &cp->key;
-                        CharData *cd = cp->data.get();
+                        CharData *cd = char_edit(cp);
 
                         afi.delflag = 1;
                         Packet_Payload<0x2afd> payload_fd; // not file descriptor
                         payload_fd.account_id = account_id;
                         payload_fd.login_id2 = afi.login_id2;
                         cd->sex = afi.sex;
+                        char_dirty.insert(ck->char_id);
                         payload_fd.packet_tmw_version = afi.packet_tmw_version;
                         FPRINTF(stderr,
                                 "From queue index %zd: recalling packet version %d\n"_fmt,
@@ -1730,24 +2028,13 @@ void parse_frommap(Session *ms)
                 if (char_conf.anti_freeze_enable)
                     server_freezeflag[id] = 5;  // Map anti-freeze system. Counter. 5 ok, 4...0 freezed
                 // remove all previously online players of the server
-                for (Session *& oci : online_chars)
-                {
-                    // there was a bug here
-                    if (oci == ms)
-                        oci = nullptr;
-                }
+                set_offline_all(ms);
                 // add online players in the list by [Yor]
                 for (int i = 0; i < server[id].users; i++)
                 {
                     CharId char_id = repeat[i].char_id;
-                    for (const CharPair& cd : char_keys)
-                    {
-                        if (cd.key.char_id == char_id)
-                        {
-                            server_for_m(&cd) = ms;
-                            break;
-                        }
-                    }
+                    if (find_char_id(char_id))
+                        online_chars.insert(char_id, ms);
                 }
                 if (update_online < TimeT::now())
                 {
@@ -1770,15 +2057,12 @@ void parse_frommap(Session *ms)
 
                 AccountId aid = payload.account_id;
                 CharId cid = payload.char_id;
-                for (CharPair& cd : char_keys)
+                CharPair *cp = find_char_id(cid);
+                if (cp && cp->key.account_id == aid)
                 {
-                    if (cd.key.account_id == aid &&
-                        cd.key.char_id == cid)
-                    {
-                        cd.key = payload.char_key;
-                        *cd.data = payload.char_data;
-                        break;
-                    }
+                    char_rekey(cp, payload.char_key);
+                    // the old data may still be being saved
+                    cp->data = std::make_shared<CharData>(payload.char_data);
                 }
                 break;
             }
@@ -1841,16 +2125,12 @@ void parse_frommap(Session *ms)
 
                 // default, if not found in the loop
                 fixed_06.error = 1;
-                for (const CharPair& cd : char_keys)
                 {
-                    AccountId aid = fixed.account_id;
-                    CharId cid = fixed.char_id;
-                    if (cd.key.account_id == aid &&
-                        cd.key.char_id == cid)
+                    const CharPair *cp = find_char_id(fixed.char_id);
+                    if (cp && cp->key.account_id == fixed.account_id)
                     {
                         auth_fifo_iter++;
                         fixed_06.error = 0;
-                        break;
                     }
                 }
                 send_fpacket<0x2b06, 44>(ms, fixed_06);
@@ -2091,14 +2371,8 @@ void parse_frommap(Session *ms)
 
                 {
                     CharId cid = fixed.char_id;
-                    for (CharPair& cd : char_keys)
-                    {
-                        if (cd.key.char_id == cid)
-                        {
-                            char_divorce(&cd);
-                            break;
-                        }
-                    }
+                    if (CharPair *cp = find_char_id(cid))
+                        char_divorce(cp);
 
                     break;
 
@@ -2161,11 +2435,11 @@ void handle_x0066(Session *s, struct char_session_data *sd, uint8_t rfifob_2, IP
 {
     {
         CharPair *cp = nullptr;
-        for (CharPair& cdi : char_keys)
+        for (CharPair *cdi : chars_of_account(sd->account_id))
         {
-            if (cdi.key.account_id == sd->account_id && cdi.key.char_num == rfifob_2)
+            if (cdi->key.char_num == rfifob_2)
             {
-                cp = &cdi;
+                cp = cdi;
                 break;
             }
         }
@@ -2190,6 +2464,7 @@ void handle_x0066(Session *s, struct char_session_data *sd, uint8_t rfifob_2, IP
                         && server[j].maps[0])
                     {   // change save point to one of map found on the server (the first)
                         i = j;
+                        cd = char_edit(cp);
                         cd->last_point.map_ = server[j].maps[0];
                         PRINTF("Map-server #%d found with a map: '%s'.\n"_fmt,
                                 j, server[j].maps[0]);
@@ -2477,27 +2752,14 @@ void parse_char(Session *s)
                 {
                     {
                         CharId cid = fixed.char_id;
-                        CharPair *cs = nullptr;
-                        for (CharPair& cd : char_keys)
-                        {
-                            if (cd.key.char_id == cid)
-                            {
-                                if (cd.key.account_id == sd->account_id)
-                                    cs = &cd;
-                                break;
-                            }
-                        }
+                        CharPair *cs = find_char_id(cid);
+                        if (cs && cs->key.account_id != sd->account_id)
+                            cs = nullptr;
 
                         if (cs)
                         {
                             char_delete(cs);   // deletion process
-
-                            if (cs != &char_keys.back())
-                            {
-                                std::swap(*cs, char_keys.back());
-                            }
-
-                            char_keys.pop_back();
+                            char_erase(cs);
                             Packet_Fixed<0x006f> fixed_6f;
                             send_fpacket<0x006f, 2>(s, fixed_6f);
                             goto x68_out;
@@ -2707,16 +2969,21 @@ void term_func(void)
 {
     using namespace tmwa::char_;
     // write online players files with no player
-    std::fill(online_chars.begin(), online_chars.end(), nullptr);
-    create_online_files();
     online_chars.clear();
+    create_online_files();
 
-    mmo_char_sync();
+    // the last periodic save must be on disk before this one replaces it
+    save_thread.wait();
+    uint64_t bytes = 0;
+    mmo_char_sync(char_keys, char_id_count, &bytes);
     inter_save();
 
     gm_accounts.clear();
 
     char_keys.clear();
+    char_index_by_id.clear();
+    char_index_by_name.clear();
+    char_index_by_account.clear();
     delete_session(login_session);
     delete_session(char_session);
 
@@ -2729,6 +2996,7 @@ int do_init(Slice<ZString> argv)
     ZString argv0 = argv.pop_front();
 
     bool loaded_config_yet = false;
+    bool convert = false;
     while (argv)
     {
         ZString argvi = argv.pop_front();
@@ -2736,8 +3004,10 @@ int do_init(Slice<ZString> argv)
         {
             if (argvi == "--help"_s)
             {
-                PRINTF("Usage: %s [--help] [--version] [files...]\n"_fmt,
+                PRINTF("Usage: %s [--help] [--version] [--write-snapshot | --write-text] [files...]\n"_fmt,
                         argv0);
+                PRINTF("  --write-snapshot  load the text files, write both formats, and exit\n"_fmt);
+                PRINTF("  --write-text      load the snapshots alone, write both formats, and exit\n"_fmt);
                 exit(0);
             }
             else if (argvi == "--version"_s)
@@ -2745,6 +3015,16 @@ int do_init(Slice<ZString> argv)
                 PRINTF("%s\n"_fmt, CURRENT_VERSION_STRING);
                 exit(0);
             }
+            else if (argvi == "--write-snapshot"_s)
+            {
+                snapshot_load = SnapshotLoad::TEXT;
+                convert = true;
+            }
+            else if (argvi == "--write-text"_s)
+            {
+                snapshot_load = SnapshotLoad::SNAPSHOT;
+                convert = true;
+            }
             else
             {
                 FPRINTF(stderr, "Unknown argument: %s\n"_fmt, argvi);
@@ -2770,6 +3050,22 @@ int do_init(Slice<ZString> argv)
     mmo_char_init();
     inter_init2();
 
+    if (convert)
+    {
+        if (!runflag)
+            return 0;
+        if (snapshot_missing)
+        {
+            // writing what little was loaded would wipe out the rest
+            PRINTF("Not every snapshot could be loaded, so nothing was written.\n"_fmt);
+            exit(1);
+        }
+        uint64_t bytes = 0;
+        mmo_char_sync(char_keys, char_id_count, &bytes);
+        inter_save();
+        exit(0);
+    }
+
     update_online = TimeT::now();
     create_online_files();     // update online players files at start of the server
 
@@ -22,6 +22,9 @@
 
 #include "../generic/db.hpp"
 
+#include "../high/save_thread.hpp"
+#include "../high/snapshot.hpp"
+
 #include "../proto2/net-Storage.hpp"
 
 #include "char.hpp"
@@ -50,19 +53,53 @@ namespace tmwa
         decltype(auth_fifo)::iterator auth_fifo_iter = auth_fifo.begin();
         CharId char_id_count = wrap<CharId>(150000);
         std::vector<CharPair> char_keys;
+        // positions in char_keys, and the ids of characters by name and
+        // by account; kept in sync by char_index_add()/char_erase()
+        HashMap<CharId, size_t> char_index_by_id;
+        HashMap<CharName, CharId> char_index_by_name;
+        HashMap<AccountId, std::vector<CharId>> char_index_by_account;
         std::vector<GM_Account> gm_accounts;
-        // same size of char_keys, and id value of current server (or -1)
-        std::vector<Session *> online_chars;
+        // map server of each online character
+        HashMap<CharId, Session *> online_chars;
+        // characters changed or deleted since they were last written out
+        std::set<CharId> char_dirty;
+        // lines appended to char_txt since it was last rewritten
+        size_t char_journal_lines;
+        // char_dirty as it was when the running save was taken;
+        // put back into char_dirty if that save fails
+        std::set<CharId> char_saving;
+        // what char_journal_lines becomes once that save is on disk
+        size_t char_saving_lines;
+        SnapshotLoad snapshot_load = SnapshotLoad::NORMAL;
+        // set if --write-text was given, but a snapshot couldn't be loaded
+        bool snapshot_missing;
         // to update online files when we receiving information from a server (not less than 8 seconds)
         TimeT update_online;
-        // For forked DB writes
-        pid_t pid = 0;
 
         Map<AccountId, accreg> accreg_db;
+        // like char_dirty, char_journal_lines, char_saving and
+        // char_saving_lines, for accreg_txt
+        std::set<AccountId> accreg_dirty;
+        size_t accreg_journal_lines;
+        std::set<AccountId> accreg_saving;
+        size_t accreg_saving_lines;
 
         Map<PartyId, PartyMost> party_db;
         PartyId party_newid = wrap<PartyId>(100_u32);
+        // ... for party_txt
+        std::set<PartyId> party_dirty;
+        size_t party_journal_lines;
+        std::set<PartyId> party_saving;
+        size_t party_saving_lines;
 
         Map<AccountId, Storage> storage_db;
+        // ... and for storage_txt
+        std::set<AccountId> storage_dirty;
+        size_t storage_journal_lines;
+        std::set<AccountId> storage_saving;
+        size_t storage_saving_lines;
+
+        // writes the periodic saves, from a copy taken by mmo_char_sync_timer()
+        SaveThread save_thread;
     } // namespace char_
 } // namespace tmwa
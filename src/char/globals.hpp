@@ -20,9 +20,8 @@
 
 #include "fwd.hpp"
 
-#include <sys/types.h>
-
 #include <array>
+#include <set>
 #include <vector>
 
 #include "consts.hpp"
@@ -44,16 +43,37 @@ namespace tmwa
         extern AuthFifoEntry *auth_fifo_iter;
         extern CharId char_id_count;
         extern std::vector<CharPair> char_keys;
+        extern HashMap<CharId, size_t> char_index_by_id;
+        extern HashMap<CharName, CharId> char_index_by_name;
+        extern HashMap<AccountId, std::vector<CharId>> char_index_by_account;
         extern std::vector<GM_Account> gm_accounts;
-        extern std::vector<Session *> online_chars;
+        extern HashMap<CharId, Session *> online_chars;
+        extern std::set<CharId> char_dirty;
+        extern size_t char_journal_lines;
+        extern std::set<CharId> char_saving;
+        extern size_t char_saving_lines;
+        extern SnapshotLoad snapshot_load;
+        extern bool snapshot_missing;
         extern TimeT update_online;
-        extern pid_t pid;
+        extern SaveThread save_thread;
 
         extern Map<AccountId, accreg> accreg_db;
+        extern std::set<AccountId> accreg_dirty;
+        extern size_t accreg_journal_lines;
+        extern std::set<AccountId> accreg_saving;
+        extern size_t accreg_saving_lines;
 
         extern Map<PartyId, PartyMost> party_db;
         extern PartyId party_newid;
+        extern std::set<PartyId> party_dirty;
+        extern size_t party_journal_lines;
+        extern std::set<PartyId> party_saving;
+        extern size_t party_saving_lines;
 
         extern Map<AccountId, Storage> storage_db;
+        extern std::set<AccountId> storage_dirty;
+        extern size_t storage_journal_lines;
+        extern std::set<AccountId> storage_saving;
+        extern size_t storage_saving_lines;
     } // namespace char_
 } // namespace tmwa
@@ -20,6 +20,10 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "../ints/udl.hpp"
 
 #include "../strings/mstring.hpp"
@@ -148,6 +152,7 @@ void party_check_deleted_init(PartyPair p)
                     p->member[i].account_id, p->member[i].name,
                     p.party_id, p->name);
             p->member[i] = PartyMember{};
+            party_dirty.insert(p.party_id);
         }
     }
 }
@@ -162,13 +167,24 @@ void inter_party_init(void)
     // TODO: convert to use char_id
     AString line;
     int c = 0;
+    size_t record_count = 0;
     while (in.getline(line))
     {
         PartyId i;
-        if (extract(line, record<'\t'>(&i, "%newid%"_s))
-            && party_newid < i)
+        if (extract(line, record<'\t'>(&i, "%newid%"_s)))
+        {
+            if (party_newid < i)
+                party_newid = i;
+            continue;
+        }
+        // parties saved since the file was last rewritten are appended,
+        // so a later line replaces an earlier one, or deletes it
+        if (extract(line, record<'\t'>(&i, "%deleted%"_s)))
         {
-            party_newid = i;
+            record_count++;
+            if (party_newid < next(i))
+                party_newid = next(i);
+            party_db.erase(i);
             continue;
         }
 
@@ -176,6 +192,7 @@ void inter_party_init(void)
         PartyPair pp{PartyId(), borrow(pm)};
         if (extract(line, &pp) && pp.party_id)
         {
+            record_count++;
             if (party_newid < next(pp.party_id))
                 party_newid = next(pp.party_id);
             party_check_deleted_init(pp);
@@ -191,6 +208,8 @@ void inter_party_init(void)
         }
         c++;
     }
+    // anything fixed up above is left in party_dirty for the next save
+    party_journal_lines = record_count - party_db.size();
 }
 
 // パーティーデータのセーブ用
@@ -202,7 +221,7 @@ void inter_party_save_sub(PartyPair data, io::WriteFile& fp)
 }
 
 // パーティーデータのセーブ
-int inter_party_save(void)
+int inter_party_save(Map<PartyId, PartyMost>& db, uint64_t *bytes)
 {
     io::WriteLock fp(inter_conf.party_txt);
     if (!fp.is_open())
@@ -211,15 +230,111 @@ int inter_party_save(void)
                 inter_conf.party_txt);
         return 1;
     }
-    for (auto& pair : party_db)
+    for (auto& pair : db)
     {
         PartyPair tmp{pair.first, borrow(pair.second)};
         inter_party_save_sub(tmp, fp);
     }
+    *bytes += fp.written();
+    if (!fp.close())
+    {
+        PRINTF("int_party: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.party_txt);
+        return 1;
+    }
+
+    return 0;
+}
 
+// Append just the parties changed since the last save.
+static
+int inter_party_append(Map<PartyId, PartyMost>& changed,
+        const std::vector<PartyId>& deleted, uint64_t *bytes)
+{
+    if (changed.empty() && deleted.empty())
+        return 0;
+    io::AppendFile fp(inter_conf.party_txt);
+    if (!fp.is_open())
+    {
+        PRINTF("int_party: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.party_txt);
+        return 1;
+    }
+    for (auto& pair : changed)
+    {
+        PartyPair tmp{pair.first, borrow(pair.second)};
+        inter_party_save_sub(tmp, fp);
+    }
+    for (PartyId party_id : deleted)
+        FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, party_id);
+    *bytes += fp.written();
+    if (!fp.sync())
+    {
+        PRINTF("int_party: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.party_txt);
+        return 1;
+    }
     return 0;
 }
 
+/// What one periodic save writes to party_txt.
+struct PartySave
+{
+    bool compact;
+    // every party if compact, else just the changed ones
+    Map<PartyId, PartyMost> parties;
+    std::vector<PartyId> deleted;
+};
+
+SaveThread::Job inter_party_snapshot(bool compact)
+{
+    std::shared_ptr<PartySave> save = std::make_shared<PartySave>();
+    party_saving.swap(party_dirty);
+    save->compact = compact || party_journal_lines + party_saving.size()
+        > std::max(INTER_COMPACT_LINES, party_db.size());
+    if (save->compact)
+    {
+        save->parties = party_db;
+        party_saving_lines = 0;
+    }
+    else
+    {
+        for (PartyId party_id : party_saving)
+        {
+            OMATCH_BEGIN (party_db.search(party_id))
+            {
+                OMATCH_CASE_SOME (party_most)
+                {
+                    save->parties.insert(party_id, *party_most);
+                }
+                OMATCH_CASE_NONE ()
+                {
+                    save->deleted.push_back(party_id);
+                }
+            }
+            OMATCH_END ();
+        }
+        party_saving_lines = party_journal_lines + party_saving.size();
+    }
+
+    return [save](uint64_t *bytes)
+    {
+        int failed = save->compact
+            ? inter_party_save(save->parties, bytes)
+            : inter_party_append(save->parties, save->deleted, bytes);
+        return !failed;
+    };
+}
+
+void inter_party_saved(bool ok)
+{
+    if (ok)
+        party_journal_lines = party_saving_lines;
+    else
+        party_dirty.insert(party_saving.begin(), party_saving.end());
+    party_saving.clear();
+}
+
 // パーティ名検索用
 static
 void search_partyname_sub(PartyPair p, PartyName str, Borrowed<Option<PartyPair>> dst)
@@ -279,6 +394,7 @@ int party_check_empty(const PartyPair p)
     // 誰もいないので解散
     mapif_party_broken(p.party_id, 0);
     party_db.erase(p.party_id);
+    party_dirty.insert(p.party_id);
 
     return 1;
 }
@@ -517,6 +633,7 @@ void mapif_parse_CreateParty(Session *s, AccountId account_id, PartyName name, C
     p.member[0].lv = lv;
 
     party_db.insert(pp.party_id, p);
+    party_dirty.insert(pp.party_id);
 
     // pointer to noncanonical version
     mapif_party_created(s, account_id, Some(pp));
@@ -567,6 +684,7 @@ void mapif_parse_PartyAddMember(Session *s, PartyId party_id, AccountId account_
             p->member[i].leader = 0;
             p->member[i].online = 1;
             p->member[i].lv = lv;
+            party_dirty.insert(party_id);
             mapif_party_memberadded(s, party_id, account_id, 0);
             mapif_party_info(nullptr, p);
 
@@ -599,6 +717,7 @@ void mapif_parse_PartyChangeOption(Session *s, PartyId party_id, AccountId accou
     }
 
     p->item = item;
+    party_dirty.insert(party_id);
 
     mapif_party_optionchanged(s, p, account_id, flag);
 }
@@ -615,6 +734,7 @@ void mapif_parse_PartyLeave(Session *, PartyId party_id, AccountId account_id)
         mapif_party_leaved(party_id, account_id, p->member[i].name);
 
         p->member[i] = PartyMember{};
+        party_dirty.insert(party_id);
         if (party_check_empty(p) == 0)
             mapif_party_info(nullptr, p);   // まだ人がいるのでデータ送信
         return;
@@ -639,10 +759,12 @@ void mapif_parse_PartyChangeMap(Session *s, PartyId party_id, AccountId account_
         p->member[i].lv = lv;
         mapif_party_membermoved(p, i);
 
+        // the map and level of the members aren't saved, but this is
         if (p->exp > 0 && !party_check_exp_share(p))
         {
             p->exp = 0;
             flag = 1;
+            party_dirty.insert(party_id);
         }
         if (flag)
             mapif_party_optionchanged(s, p, AccountId(), 0);
@@ -22,13 +22,22 @@
 
 #include "fwd.hpp"
 
+#include <cstdint>
+
+#include "../high/save_thread.hpp"
+
 
 namespace tmwa
 {
 namespace char_
 {
 void inter_party_init(void);
-int inter_party_save(void);
+int inter_party_save(Map<PartyId, PartyMost>& db, uint64_t *bytes);
+/// Copy the parties changed since the last save (or all of them,
+/// if compact or it is time to), and return a job that writes them.
+SaveThread::Job inter_party_snapshot(bool compact);
+/// Report whether the last snapshot's job succeeded.
+void inter_party_saved(bool ok);
 
 RecvResult inter_party_parse_frommap(Session *ms, uint16_t);
 
@@ -20,6 +20,10 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "../strings/mstring.hpp"
 #include "../strings/astring.hpp"
 #include "../strings/xstring.hpp"
@@ -27,10 +31,11 @@
 
 #include "../generic/db.hpp"
 
+#include "../io/chunk.hpp"
 #include "../io/cxxstdio.hpp"
 #include "../io/extract.hpp"
 #include "../io/lock.hpp"
-#include "../io/read.hpp"
+#include "../io/mmap.hpp"
 #include "../io/write.hpp"
 
 #include "../proto2/char-map.hpp"
@@ -39,10 +44,12 @@
 
 #include "../high/extract_mmo.hpp"
 #include "../high/mmo.hpp"
+#include "../high/snapshot.hpp"
 
 #include "../wire/packets.hpp"
 
 #include "globals.hpp"
+#include "inter.hpp"
 #include "inter_conf.hpp"
 
 #include "../poison.hpp"
@@ -119,6 +126,13 @@ bool impl_extract(XString str, Storage *p)
 
 namespace char_
 {
+/// One line of storage_txt, as parsed by a loader thread.
+struct StorageLine
+{
+    enum { STORAGE, DELETED, BROKEN } kind;
+    Storage s {};
+};
+
 // アカウントから倉庫データインデックスを得る（新規倉庫追加可能）
 Borrowed<Storage> account2storage(AccountId account_id)
 {
@@ -133,28 +147,61 @@ void inter_storage_init(void)
 {
     int c = 0;
 
-    io::ReadFile in(inter_conf.storage_txt);
-    if (!in.is_open())
-    {
-        PRINTF("cant't read : %s\n"_fmt, inter_conf.storage_txt);
-        return;
-    }
-
-    AString line;
-    while (in.getline(line))
+    SnapshotReader snap(inter_conf.storage_bin, inter_conf.storage_txt, snapshot_load,
+            "storage"_s, sizeof(NetStorage));
+    if (snapshot_load == SnapshotLoad::SNAPSHOT && !snap.is_open())
+        snapshot_missing = true;
+    for (size_t i = 0; i < snap.size(); ++i)
     {
         Storage s {};
-        if (extract(line, &s))
-        {
+        if (network_to_native(&s, snap.get<NetStorage>(i)) && s.account_id)
             storage_db.insert(s.account_id, s);
-        }
         else
-        {
-            PRINTF("int_storage: broken data [%s] line %d\n"_fmt,
-                    inter_conf.storage_txt, c);
-        }
-        c++;
+            PRINTF("int_storage: broken data [%s] record %zu\n"_fmt,
+                    inter_conf.storage_bin, i);
+    }
+    size_t record_count = storage_db.size();
+
+    io::MappedFile text(inter_conf.storage_txt);
+    if (!text.is_open())
+    {
+        if (!snap.is_open())
+            PRINTF("cant't read : %s\n"_fmt, inter_conf.storage_txt);
+        return;
     }
+
+    // As with the characters, a later line for the same account
+    // replaces an earlier one, and a "%deleted%" line removes it.
+    io::parse_lines<StorageLine>(snap.text_tail(text),
+            [](XString line, StorageLine *sl)
+            {
+                if (extract(line, record<'\t'>(&sl->s.account_id, "%deleted%"_s)))
+                    sl->kind = StorageLine::DELETED;
+                else if (extract(line, &sl->s))
+                    sl->kind = StorageLine::STORAGE;
+                else
+                    sl->kind = StorageLine::BROKEN;
+            },
+            [&c, &record_count](XString, StorageLine& sl)
+            {
+                switch (sl.kind)
+                {
+                case StorageLine::STORAGE:
+                    record_count++;
+                    storage_db.insert(sl.s.account_id, sl.s);
+                    break;
+                case StorageLine::DELETED:
+                    record_count++;
+                    storage_db.erase(sl.s.account_id);
+                    break;
+                case StorageLine::BROKEN:
+                    PRINTF("int_storage: broken data [%s] line %d\n"_fmt,
+                            inter_conf.storage_txt, c);
+                    break;
+                }
+                c++;
+            });
+    storage_journal_lines = record_count - storage_db.size();
 }
 
 static
@@ -167,25 +214,161 @@ void inter_storage_save_sub(Storage *data, io::WriteFile& fp)
 
 //---------------------------------------------------------
 // 倉庫データを書き込む
-int inter_storage_save(void)
+int inter_storage_save(Map<AccountId, Storage>& db, uint64_t *bytes)
 {
-    io::WriteLock fp(inter_conf.storage_txt);
+    {
+        io::WriteLock fp(inter_conf.storage_txt);
+
+        if (!fp.is_open())
+        {
+            PRINTF("int_storage: cant write [%s] !!! data is lost !!!\n"_fmt,
+                    inter_conf.storage_txt);
+            return 1;
+        }
+        for (auto& pair : db)
+            inter_storage_save_sub(&pair.second, fp);
+        *bytes += fp.written();
+        if (!fp.close())
+        {
+            PRINTF("int_storage: cant write [%s] !!! data is lost !!!\n"_fmt,
+                    inter_conf.storage_txt);
+            return 1;
+        }
+    }
 
+    if (!inter_conf.storage_bin)
+        return 0;
+    SnapshotWriter snap(inter_conf.storage_bin, inter_conf.storage_txt,
+            "storage"_s, sizeof(NetStorage), 0);
+    if (!snap.is_open())
+    {
+        PRINTF("int_storage: cant write [%s]\n"_fmt,
+                inter_conf.storage_bin);
+        return 1;
+    }
+    for (auto& pair : db)
+    {
+        NetStorage net;
+        if (!native_to_network(&net, pair.second))
+        {
+            // leaving it out would lose it on the next load
+            PRINTF("int_storage: storage %d can't go in [%s], not writing it\n"_fmt,
+                    pair.first, inter_conf.storage_bin);
+            snap.abandon();
+            return 0;
+        }
+        snap.put(net);
+    }
+    *bytes += snap.written();
+    if (!snap.close())
+    {
+        PRINTF("int_storage: cant write [%s]\n"_fmt,
+                inter_conf.storage_bin);
+        return 1;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------
+// Append just the storages changed since the last save.
+// One that has been emptied is written as deleted, since
+// storage_tostr() gives nothing for it.
+static
+int inter_storage_append(Map<AccountId, Storage>& changed,
+        const std::vector<AccountId>& deleted, uint64_t *bytes)
+{
+    if (changed.empty() && deleted.empty())
+        return 0;
+    io::AppendFile fp(inter_conf.storage_txt);
     if (!fp.is_open())
     {
         PRINTF("int_storage: cant write [%s] !!! data is lost !!!\n"_fmt,
                 inter_conf.storage_txt);
         return 1;
     }
-    for (auto& pair : storage_db)
-        inter_storage_save_sub(&pair.second, fp);
+    for (auto& pair : changed)
+    {
+        AString line = storage_tostr(&pair.second);
+        if (line)
+            fp.put_line(line);
+        else
+            FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, pair.first);
+    }
+    for (AccountId account_id : deleted)
+        FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, account_id);
+    *bytes += fp.written();
+    if (!fp.sync())
+    {
+        PRINTF("int_storage: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.storage_txt);
+        return 1;
+    }
     return 0;
 }
 
+/// What one periodic save writes to storage_txt.
+struct StorageSave
+{
+    bool compact;
+    // every storage if compact, else just the changed ones
+    Map<AccountId, Storage> storages;
+    std::vector<AccountId> deleted;
+};
+
+SaveThread::Job inter_storage_snapshot(bool compact)
+{
+    std::shared_ptr<StorageSave> save = std::make_shared<StorageSave>();
+    storage_saving.swap(storage_dirty);
+    save->compact = compact || storage_journal_lines + storage_saving.size()
+        > std::max(INTER_COMPACT_LINES, storage_db.size());
+    if (save->compact)
+    {
+        save->storages = storage_db;
+        storage_saving_lines = 0;
+    }
+    else
+    {
+        for (AccountId account_id : storage_saving)
+        {
+            OMATCH_BEGIN (storage_db.search(account_id))
+            {
+                OMATCH_CASE_SOME (st)
+                {
+                    save->storages.insert(account_id, *st);
+                }
+                OMATCH_CASE_NONE ()
+                {
+                    save->deleted.push_back(account_id);
+                }
+            }
+            OMATCH_END ();
+        }
+        storage_saving_lines = storage_journal_lines + storage_saving.size();
+    }
+
+    return [save](uint64_t *bytes)
+    {
+        int failed = save->compact
+            ? inter_storage_save(save->storages, bytes)
+            : inter_storage_append(save->storages, save->deleted, bytes);
+        return !failed;
+    };
+}
+
+void inter_storage_saved(bool ok)
+{
+    if (ok)
+        storage_journal_lines = storage_saving_lines;
+    else
+        storage_dirty.insert(storage_saving.begin(), storage_saving.end());
+    storage_saving.clear();
+}
+
 // 倉庫データ削除
 void inter_storage_delete(AccountId account_id)
 {
     storage_db.erase(account_id);
+    storage_dirty.insert(account_id);
 }
 
 //---------------------------------------------------------
@@ -244,6 +427,7 @@ RecvResult mapif_parse_SaveStorage(Session *ss)
     {
         P<Storage> st = account2storage(account_id);
         *st = payload.storage;
+        storage_dirty.insert(account_id);
         mapif_save_storage_ack(ss, account_id);
     }
 
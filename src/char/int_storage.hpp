@@ -22,13 +22,22 @@
 
 #include "fwd.hpp"
 
+#include <cstdint>
+
+#include "../high/save_thread.hpp"
+
 
 namespace tmwa
 {
 namespace char_
 {
 void inter_storage_init(void);
-int inter_storage_save(void);
+int inter_storage_save(Map<AccountId, Storage>& db, uint64_t *bytes);
+/// Copy the storages changed since the last save (or all of them,
+/// if compact or it is time to), and return a job that writes them.
+SaveThread::Job inter_storage_snapshot(bool compact);
+/// Report whether the last snapshot's job succeeded.
+void inter_storage_saved(bool ok);
 void inter_storage_delete(AccountId account_id);
 Borrowed<Storage> account2storage(AccountId account_id);
 
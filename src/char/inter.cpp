@@ -22,6 +22,8 @@
 
 #include <cassert>
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "../strings/mstring.hpp"
@@ -101,6 +103,7 @@ static
 void inter_accreg_init(void)
 {
     int c = 0;
+    size_t record_count = 0;
 
     io::ReadFile in(inter_conf.accreg_txt);
     if (!in.is_open())
@@ -109,8 +112,16 @@ void inter_accreg_init(void)
     while (in.getline(line))
     {
         struct accreg reg {};
-        if (extract(line, &reg))
+        // a later line for the same account replaces an earlier one,
+        // and a "%deleted%" line clears it
+        if (extract(line, record<'\t'>(&reg.account_id, "%deleted%"_s)))
         {
+            record_count++;
+            accreg_db.erase(reg.account_id);
+        }
+        else if (extract(line, &reg))
+        {
+            record_count++;
             accreg_db.insert(reg.account_id, reg);
         }
         else
@@ -120,6 +131,7 @@ void inter_accreg_init(void)
         }
         c++;
     }
+    accreg_journal_lines = record_count - accreg_db.size();
 }
 
 // アカウント変数のセーブ用
@@ -135,7 +147,7 @@ void inter_accreg_save_sub(struct accreg *reg, io::WriteFile& fp)
 
 // アカウント変数のセーブ
 static
-int inter_accreg_save(void)
+int inter_accreg_save(Map<AccountId, accreg>& db, uint64_t *bytes)
 {
     io::WriteLock fp(inter_conf.accreg_txt);
     if (!fp.is_open())
@@ -144,18 +156,142 @@ int inter_accreg_save(void)
                 inter_conf.accreg_txt);
         return 1;
     }
-    for (auto& pair : accreg_db)
+    for (auto& pair : db)
         inter_accreg_save_sub(&pair.second, fp);
+    *bytes += fp.written();
+    if (!fp.close())
+    {
+        PRINTF("int_accreg: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.accreg_txt);
+        return 1;
+    }
 
     return 0;
 }
 
+// Append just the account variables changed since the last save.
+// Ones that have all been cleared are written as deleted.
+static
+int inter_accreg_append(Map<AccountId, accreg>& changed,
+        const std::vector<AccountId>& deleted, uint64_t *bytes)
+{
+    if (changed.empty() && deleted.empty())
+        return 0;
+    io::AppendFile fp(inter_conf.accreg_txt);
+    if (!fp.is_open())
+    {
+        PRINTF("int_accreg: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.accreg_txt);
+        return 1;
+    }
+    for (auto& pair : changed)
+    {
+        if (pair.second.reg_num > 0)
+            inter_accreg_save_sub(&pair.second, fp);
+        else
+            FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, pair.first);
+    }
+    for (AccountId account_id : deleted)
+        FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, account_id);
+    *bytes += fp.written();
+    if (!fp.sync())
+    {
+        PRINTF("int_accreg: cant write [%s] !!! data is lost !!!\n"_fmt,
+                inter_conf.accreg_txt);
+        return 1;
+    }
+    return 0;
+}
+
+/// What one periodic save writes to accreg_txt.
+struct AccregSave
+{
+    bool compact;
+    // every account if compact, else just the changed ones
+    Map<AccountId, accreg> accregs;
+    std::vector<AccountId> deleted;
+};
+
+static
+SaveThread::Job inter_accreg_snapshot(bool compact)
+{
+    std::shared_ptr<AccregSave> save = std::make_shared<AccregSave>();
+    accreg_saving.swap(accreg_dirty);
+    save->compact = compact || accreg_journal_lines + accreg_saving.size()
+        > std::max(INTER_COMPACT_LINES, accreg_db.size());
+    if (save->compact)
+    {
+        save->accregs = accreg_db;
+        accreg_saving_lines = 0;
+    }
+    else
+    {
+        for (AccountId account_id : accreg_saving)
+        {
+            OMATCH_BEGIN (accreg_db.search(account_id))
+            {
+                OMATCH_CASE_SOME (reg)
+                {
+                    save->accregs.insert(account_id, *reg);
+                }
+                OMATCH_CASE_NONE ()
+                {
+                    save->deleted.push_back(account_id);
+                }
+            }
+            OMATCH_END ();
+        }
+        accreg_saving_lines = accreg_journal_lines + accreg_saving.size();
+    }
+
+    return [save](uint64_t *bytes)
+    {
+        int failed = save->compact
+            ? inter_accreg_save(save->accregs, bytes)
+            : inter_accreg_append(save->accregs, save->deleted, bytes);
+        return !failed;
+    };
+}
+
+static
+void inter_accreg_saved(bool ok)
+{
+    if (ok)
+        accreg_journal_lines = accreg_saving_lines;
+    else
+        accreg_dirty.insert(accreg_saving.begin(), accreg_saving.end());
+    accreg_saving.clear();
+}
+
 // セーブ
 void inter_save(void)
 {
-    inter_party_save();
-    inter_storage_save();
-    inter_accreg_save();
+    uint64_t bytes = 0;
+    inter_party_save(party_db, &bytes);
+    inter_storage_save(storage_db, &bytes);
+    inter_accreg_save(accreg_db, &bytes);
+}
+
+SaveThread::Job inter_snapshot(bool compact)
+{
+    SaveThread::Job party = inter_party_snapshot(compact);
+    SaveThread::Job storage = inter_storage_snapshot(compact);
+    SaveThread::Job accreg = inter_accreg_snapshot(compact);
+    return [party, storage, accreg](uint64_t *bytes)
+    {
+        // like inter_save(), all three are written even if one fails
+        bool ok = party(bytes);
+        ok &= storage(bytes);
+        ok &= accreg(bytes);
+        return ok;
+    };
+}
+
+void inter_saved(bool ok)
+{
+    inter_party_saved(ok);
+    inter_storage_saved(ok);
+    inter_accreg_saved(ok);
 }
 
 // 初期化
@@ -385,6 +521,7 @@ RecvResult mapif_parse_AccReg(Session *s)
         reg->reg[j].value = repeat[j].value;
     }
     reg->reg_num = jlim;
+    accreg_dirty.insert(head.account_id);
 
     // 他のMAPサーバーに送信
     mapif_account_reg(s, head.account_id, repeat);
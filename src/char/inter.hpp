@@ -22,6 +22,8 @@
 
 #include "fwd.hpp"
 
+#include <cstddef>
+
 #include "../generic/array.hpp"
 
 #include "../mmo/consts.hpp"
@@ -29,11 +31,16 @@
 
 #include "../proto2/net-GlobalReg.hpp"
 
+#include "../high/save_thread.hpp"
+
 
 namespace tmwa
 {
 namespace char_
 {
+/// Like CHAR_COMPACT_LINES, for the party, storage and accreg files.
+constexpr size_t INTER_COMPACT_LINES = 4096;
+
 struct accreg
 {
     AccountId account_id;
@@ -43,6 +50,12 @@ struct accreg
 
 void inter_init2();
 void inter_save(void);
+/// Copy what changed in the inter-server databases since the last save
+/// (or all of them, if compact), and return a job that saves the copy.
+SaveThread::Job inter_snapshot(bool compact);
+/// Report whether the last snapshot's job succeeded. If not, what it
+/// held counts as changed again.
+void inter_saved(bool ok);
 RecvResult inter_parse_frommap(Session *ms, uint16_t packet_id);
 } // namespace char_
 } // namespace tmwa
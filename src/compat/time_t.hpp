@@ -40,7 +40,8 @@ struct TimeT : Comparable
     TimeT(time_t t=0) : value(t) {}
     TimeT(struct tm t) : value(timegm(&t)) {}
     operator time_t() const { return value; }
-    operator struct tm() const { time_t v = value; return *gmtime(&v); }
+    // gmtime_r, since accounts are parsed on several threads at once
+    operator struct tm() const { time_t v = value; struct tm t; gmtime_r(&v, &t); return t; }
 
     explicit operator bool() const { return value; }
     bool operator !() const { return !value; }
@@ -22,6 +22,7 @@
 
 #include <map>
 #include <memory>
+#include <unordered_map>
 
 #include "../compat/borrow.hpp"
 
@@ -96,6 +97,81 @@ public:
     }
 };
 
+/// Like Map, but backed by a hash table instead of a tree.
+///
+/// For big tables that are only ever searched by key. Iteration order
+/// is unspecified. K must have a hash_key() overload that can be found
+/// by argument-dependent lookup; see ints/wrap.hpp and strings/xstring.hpp.
+template<class K, class V>
+class HashMap
+{
+    struct Hash
+    {
+        size_t operator()(const K& k) const
+        {
+            return hash_key(k);
+        }
+    };
+    typedef std::unordered_map<K, V, Hash> Impl;
+
+    Impl impl;
+public:
+    typedef typename Impl::iterator iterator;
+    typedef typename Impl::const_iterator const_iterator;
+
+    iterator begin() { return impl.begin(); }
+    iterator end() { return impl.end(); }
+    const_iterator begin() const { return impl.begin(); }
+    const_iterator end() const { return impl.end(); }
+
+    Option<Borrowed<V>> search(const K& k)
+    {
+        iterator it = impl.find(k);
+        if (it == impl.end())
+            return None;
+        return Some(borrow(it->second));
+    }
+    Option<Borrowed<const V>> search(const K& k) const
+    {
+        const_iterator it = impl.find(k);
+        if (it == impl.end())
+            return None;
+        return Some(borrow(it->second));
+    }
+    void insert(const K& k, V v)
+    {
+        iterator it = impl.find(k);
+        if (it != impl.end())
+            it->second = std::move(v);
+        else
+            impl.emplace(k, std::move(v));
+    }
+    Borrowed<V> init(const K& k)
+    {
+        return borrow(impl[k]);
+    }
+    void erase(const K& k)
+    {
+        impl.erase(k);
+    }
+    void clear()
+    {
+        impl.clear();
+    }
+    bool empty() const
+    {
+        return impl.empty();
+    }
+    size_t size() const
+    {
+        return impl.size();
+    }
+    void reserve(size_t n)
+    {
+        impl.reserve(n);
+    }
+};
+
 template<class K, class V>
 class DMap
 {
@@ -0,0 +1,78 @@
+#include "db.hpp"
+//    db_test.cpp - Testsuite for the map wrappers.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include "../ints/wrap.hpp"
+
+#include "../strings/rstring.hpp"
+#include "../strings/xstring.hpp"
+#include "../strings/literal.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace
+{
+    class Id : public Wrapped<uint32_t> { public: constexpr Id() : Wrapped<uint32_t>() {} protected: constexpr explicit Id(uint32_t a) : Wrapped<uint32_t>(a) {} };
+} // anonymous namespace
+
+TEST(HashMap, ids)
+{
+    HashMap<Id, int> m;
+    EXPECT_TRUE(m.empty());
+    m.insert(wrap<Id>(1), 10);
+    m.insert(wrap<Id>(2), 20);
+    m.insert(wrap<Id>(1), 11);
+    EXPECT_EQ(2u, m.size());
+
+    EXPECT_EQ(11, *TRY_UNWRAP(m.search(wrap<Id>(1)), FAIL()));
+    EXPECT_EQ(20, *TRY_UNWRAP(m.search(wrap<Id>(2)), FAIL()));
+    EXPECT_TRUE(m.search(wrap<Id>(3)).is_none());
+
+    *m.init(wrap<Id>(3)) += 30;
+    EXPECT_EQ(30, *TRY_UNWRAP(m.search(wrap<Id>(3)), FAIL()));
+
+    m.erase(wrap<Id>(1));
+    EXPECT_TRUE(m.search(wrap<Id>(1)).is_none());
+    EXPECT_EQ(2u, m.size());
+    m.clear();
+    EXPECT_TRUE(m.empty());
+}
+
+TEST(HashMap, strings)
+{
+    HashMap<RString, int> m;
+    m.reserve(100);
+    for (int i = 0; i < 100; ++i)
+    {
+        char key[2] = {char('a' + i / 10), char('a' + i % 10)};
+        m.insert(RString(XString(key, key + 2, nullptr)), i);
+    }
+    EXPECT_EQ(100u, m.size());
+    EXPECT_EQ(42, *TRY_UNWRAP(m.search("ec"_s), FAIL()));
+    EXPECT_TRUE(m.search("ka"_s).is_none());
+
+    EXPECT_EQ(hash_key(XString("abc"_s)), hash_key(RString("abc"_s)));
+    EXPECT_NE(hash_key(XString("abc"_s)), hash_key(XString("abd"_s)));
+}
+} // namespace tmwa
@@ -34,11 +34,17 @@ class dumb_ptr;
 template<class K, class V>
 class Map;
 template<class K, class V>
+class HashMap;
+template<class K, class V>
 class DMap;
 template<class K, class V>
 class UPMap;
 
 class InternPool;
+template<class T, size_t n>
+class ObjectPool;
+template<class T, size_t n>
+class PoolAllocated;
 
 // arrays are complicated
 template<class I, I be, I en>
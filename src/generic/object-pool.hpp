@@ -0,0 +1,123 @@
+#pragma once
+//    object-pool.hpp - Fixed-size storage for frequently recycled objects.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <cassert>
+#include <cstddef>
+
+#include <memory>
+#include <vector>
+
+
+namespace tmwa
+{
+/// Raw storage for objects of type T, carved out of slabs of n slots.
+///
+/// Freed slots go onto an intrusive free list and are handed out again
+/// before a new slab is allocated, so both allocate() and deallocate()
+/// are O(1). Slabs are never returned to the system until the pool dies.
+template<class T, size_t n>
+class ObjectPool
+{
+    union Slot
+    {
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    Slot *free_list = nullptr;
+    size_t live_ = 0;
+    size_t high_water_ = 0;
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator = (const ObjectPool&) = delete;
+public:
+    ObjectPool() = default;
+
+    void *allocate()
+    {
+        if (!free_list)
+        {
+            std::unique_ptr<Slot[]> slab(new Slot[n]);
+            for (size_t i = n; i-->0; )
+            {
+                slab[i].next = free_list;
+                free_list = &slab[i];
+            }
+            slabs.push_back(std::move(slab));
+        }
+        Slot *slot = free_list;
+        free_list = slot->next;
+        if (++live_ > high_water_)
+            high_water_ = live_;
+        return slot->storage;
+    }
+
+    void deallocate(void *p)
+    {
+        if (!p)
+            return;
+        assert (live_ > 0);
+        Slot *slot = static_cast<Slot *>(p);
+        slot->next = free_list;
+        free_list = slot;
+        --live_;
+    }
+
+    /// Number of objects currently allocated.
+    size_t live() const { return live_; }
+    /// Largest value live() has ever had.
+    size_t high_water() const { return high_water_; }
+    /// Number of slots in all slabs, whether in use or not.
+    size_t capacity() const { return slabs.size() * n; }
+};
+
+/// Base class that makes `new T` and `delete` use an ObjectPool.
+///
+/// Since the operators are class-specific, dumb_ptr::new_() and
+/// delete_() are routed here without changing any callers, and so is
+/// deletion through a base pointer with a virtual destructor.
+/// T must be final in practice: allocating a subclass will assert.
+template<class T, size_t n>
+class PoolAllocated
+{
+public:
+    static
+    ObjectPool<T, n>& pool()
+    {
+        static ObjectPool<T, n> p;
+        return p;
+    }
+
+    static
+    void *operator new(size_t sz)
+    {
+        assert (sz == sizeof(T));
+        return pool().allocate();
+    }
+    static
+    void operator delete(void *p)
+    {
+        pool().deallocate(p);
+    }
+};
+} // namespace tmwa
@@ -0,0 +1,117 @@
+#include "object-pool.hpp"
+//    object-pool_test.cpp - Testsuite for recycled object storage.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "dumb_ptr.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+TEST(ObjectPool, reuse)
+{
+    ObjectPool<double, 4> p;
+    EXPECT_EQ(0u, p.live());
+    EXPECT_EQ(0u, p.capacity());
+
+    void *a = p.allocate();
+    void *b = p.allocate();
+    EXPECT_NE(a, b);
+    EXPECT_EQ(2u, p.live());
+    EXPECT_EQ(4u, p.capacity());
+
+    p.deallocate(a);
+    EXPECT_EQ(1u, p.live());
+    EXPECT_EQ(a, p.allocate());
+    EXPECT_EQ(2u, p.high_water());
+
+    p.deallocate(a);
+    p.deallocate(b);
+    p.deallocate(nullptr);
+    EXPECT_EQ(0u, p.live());
+    EXPECT_EQ(2u, p.high_water());
+    EXPECT_EQ(4u, p.capacity());
+}
+
+TEST(ObjectPool, grow)
+{
+    ObjectPool<double, 4> p;
+    std::set<void *> seen;
+    for (int i = 0; i < 10; ++i)
+    {
+        void *v = p.allocate();
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(v) % alignof(double));
+        EXPECT_TRUE(seen.insert(v).second);
+    }
+    EXPECT_EQ(10u, p.live());
+    EXPECT_EQ(10u, p.high_water());
+    EXPECT_EQ(12u, p.capacity());
+
+    for (void *v : seen)
+        p.deallocate(v);
+    EXPECT_EQ(0u, p.live());
+    EXPECT_EQ(12u, p.capacity());
+
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(1u, seen.count(p.allocate()));
+    EXPECT_EQ(0u, seen.count(p.allocate()));
+    EXPECT_EQ(0u, seen.count(p.allocate()));
+    EXPECT_EQ(12u, p.capacity());
+    EXPECT_EQ(12u, p.high_water());
+}
+
+namespace
+{
+struct Base
+{
+    virtual ~Base() {}
+};
+struct Pooled : Base, PoolAllocated<Pooled, 8>
+{
+    int *alive;
+    Pooled(int *a) : alive(a) { ++*alive; }
+    ~Pooled() { --*alive; }
+};
+} // anonymous namespace
+
+TEST(ObjectPool, allocated)
+{
+    int alive = 0;
+    auto& pool = Pooled::pool();
+    dumb_ptr<Base> a = dumb_ptr<Pooled>::make(&alive);
+    dumb_ptr<Base> b = dumb_ptr<Pooled>::make(&alive);
+    EXPECT_EQ(2, alive);
+    EXPECT_EQ(2u, pool.live());
+    EXPECT_EQ(8u, pool.capacity());
+
+    // through the virtual destructor
+    a.delete_();
+    EXPECT_EQ(1, alive);
+    EXPECT_EQ(1u, pool.live());
+    b.delete_();
+    EXPECT_EQ(0, alive);
+    EXPECT_EQ(0u, pool.live());
+    EXPECT_EQ(2u, pool.high_water());
+}
+} // namespace tmwa
@@ -36,5 +36,7 @@ namespace tmwa
 class CharPair;
 class PartyPair;
 struct GM_Account;
+enum class SnapshotLoad;
+class SaveThread;
 // meh, add more when I feel like it
 } // namespace tmwa
@@ -47,10 +47,12 @@ bool operator != (const SkillValue& l, const SkillValue& r)
 struct CharPair
 {
     CharKey key;
-    std::unique_ptr<CharData> data;
+    // may still be shared with a save being written; the char server
+    // copies it before changing it, see char_edit()
+    std::shared_ptr<CharData> data;
 
     CharPair()
-    : key{}, data(make_unique<CharData>())
+    : key{}, data(std::make_shared<CharData>())
     {}
 };
 
@@ -0,0 +1,110 @@
+#include "save_thread.hpp"
+//    save_thread.cpp - Write the databases out without stalling the server.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cassert>
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+SaveThread::SaveThread()
+: report{}, running(false), reported(true), quit(false)
+{}
+
+SaveThread::~SaveThread()
+{
+    if (!worker.joinable())
+        return;
+    {
+        std::unique_lock<std::mutex> l(lock);
+        quit = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void SaveThread::run()
+{
+    std::unique_lock<std::mutex> l(lock);
+    while (true)
+    {
+        wake.wait(l, [this]() { return running || quit; });
+        // a save that was started is always finished first
+        if (!running)
+            return;
+
+        Job j = std::move(job);
+        l.unlock();
+        uint64_t bytes = 0;
+        bool ok = j(&bytes);
+        // free the copy before telling anyone we're done
+        j = nullptr;
+        save_clock::time_point done = save_clock::now();
+        l.lock();
+
+        report.save_lag = std::chrono::duration_cast<std::chrono::milliseconds>(done - taken);
+        report.bytes_written = bytes;
+        report.ok = ok;
+        running = false;
+        reported = false;
+        wake.notify_all();
+    }
+}
+
+bool SaveThread::busy()
+{
+    std::unique_lock<std::mutex> l(lock);
+    return running;
+}
+
+void SaveThread::save(Job j, save_clock::time_point start)
+{
+    save_clock::time_point now = save_clock::now();
+    {
+        std::unique_lock<std::mutex> l(lock);
+        assert (!running);
+        job = std::move(j);
+        taken = now;
+        report.snapshot_time = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+        running = true;
+        reported = true;
+    }
+    if (!worker.joinable())
+        worker = std::thread(&SaveThread::run, this);
+    wake.notify_all();
+}
+
+void SaveThread::wait()
+{
+    std::unique_lock<std::mutex> l(lock);
+    wake.wait(l, [this]() { return !running; });
+}
+
+bool SaveThread::finished(SaveReport *out)
+{
+    std::unique_lock<std::mutex> l(lock);
+    if (running || reported)
+        return false;
+    *out = report;
+    reported = true;
+    return true;
+}
+} // namespace tmwa
@@ -0,0 +1,87 @@
+#pragma once
+//    save_thread.hpp - Write the databases out without stalling the server.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <cstdint>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+namespace tmwa
+{
+// The periodic saves used to fork() the whole server so that the child
+// could write the files from its copy of memory. Instead, the main
+// thread now copies just the records that are to be written, and hands
+// the copy to a thread that does the writing.
+
+using save_clock = std::chrono::steady_clock;
+
+/// How the last save went.
+struct SaveReport
+{
+    /// How long the main thread spent copying the records.
+    std::chrono::microseconds snapshot_time;
+    /// From the copy being taken to the files being written.
+    std::chrono::milliseconds save_lag;
+    uint64_t bytes_written;
+    bool ok;
+};
+
+class SaveThread
+{
+public:
+    /// Writes a copy of some records, adding up what it wrote in *bytes.
+    /// It runs alongside the main thread, so it may only touch what it
+    /// owns, and configuration, which doesn't change while running.
+    typedef std::function<bool(uint64_t *bytes)> Job;
+private:
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread worker;
+    Job job;
+    save_clock::time_point taken;
+    SaveReport report;
+    bool running;
+    bool reported;
+    bool quit;
+
+    void run();
+public:
+    SaveThread();
+    SaveThread(SaveThread&&) = delete;
+    SaveThread& operator = (SaveThread&&) = delete;
+    ~SaveThread();
+
+    /// Whether the last save is still being written.
+    bool busy();
+    /// Start writing a save, whose copy was started at start.
+    /// Must not be called while busy().
+    void save(Job j, save_clock::time_point start);
+    /// Wait for the last save to be written.
+    void wait();
+    /// Get the report of the last save, once it is written.
+    bool finished(SaveReport *out);
+};
+} // namespace tmwa
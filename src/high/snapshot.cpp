@@ -0,0 +1,128 @@
+#include "snapshot.hpp"
+//    snapshot.cpp - Binary snapshots of the flat-file databases.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../strings/vstring.hpp"
+#include "../strings/xstring.hpp"
+#include "../strings/zstring.hpp"
+
+#include "../io/cxxstdio.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+constexpr uint32_t SNAPSHOT_MAGIC = 0x50414e53; // "SNAP"
+// Bump this if a record struct changes without changing its size.
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+// Hashing the text is much cheaper than parsing it, and catches any
+// edit made by hand since the snapshot was written.
+static
+uint64_t hash_text(io::MappedFile& text, uint64_t len)
+{
+    return hash_key(XString(text.data(), text.data() + len, nullptr));
+}
+
+SnapshotReader::SnapshotReader(ZString snapshot, ZString text, SnapshotLoad how,
+        XString kind, size_t rs)
+: file(how == SnapshotLoad::TEXT ? ZString() : snapshot)
+, record_size(rs), count(0), text_size(0), id(0)
+, skip_text(how == SnapshotLoad::SNAPSHOT), valid(false)
+{
+    if (!file.is_open())
+        return;
+
+    uint32_t magic = 0, version = 0, size = 0;
+    VString<15> file_kind;
+    uint64_t hash = 0;
+    bool ok = file.size() >= sizeof(NetSnapshotHeader);
+    if (ok)
+    {
+        const NetSnapshotHeader& net = *reinterpret_cast<const NetSnapshotHeader *>(file.data());
+        ok &= network_to_native(&magic, net.magic);
+        ok &= network_to_native(&version, net.version);
+        ok &= network_to_native(&file_kind, net.kind);
+        ok &= network_to_native(&size, net.record_size);
+        ok &= network_to_native(&id, net.next_id);
+        ok &= network_to_native(&text_size, net.text_size);
+        ok &= network_to_native(&hash, net.text_hash);
+    }
+    if (!ok || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION
+            || file_kind != kind || size != record_size
+            || (file.size() - sizeof(NetSnapshotHeader)) % record_size)
+    {
+        PRINTF("%s: not a snapshot from this version, ignoring\n"_fmt,
+                snapshot);
+        return;
+    }
+
+    if (!skip_text)
+    {
+        io::MappedFile tf(text);
+        bool same = tf.is_open()
+            && tf.size() >= text_size
+            && hash_text(tf, text_size) == hash;
+        if (!same)
+        {
+            PRINTF("%s: %s was rewritten since, ignoring the snapshot\n"_fmt,
+                    snapshot, text);
+            return;
+        }
+    }
+
+    count = (file.size() - sizeof(NetSnapshotHeader)) / record_size;
+    valid = true;
+}
+
+XString SnapshotReader::text_tail(io::MappedFile& text)
+{
+    if (valid && skip_text)
+        return XString();
+    size_t skip = valid ? text_size : 0;
+    if (!text.is_open() || text.size() < skip)
+        return XString();
+    return XString(text.data() + skip, text.data() + text.size(), nullptr);
+}
+
+SnapshotWriter::SnapshotWriter(ZString snapshot, ZString text,
+        XString kind, size_t rs, uint32_t next_id)
+: out(snapshot), record_size(rs)
+{
+    if (!out.is_open())
+        return;
+
+    io::MappedFile tf(text);
+    uint64_t text_size = tf.size();
+    uint64_t hash = hash_text(tf, text_size);
+
+    NetSnapshotHeader net;
+    bool ok = true;
+    ok &= native_to_network(&net.magic, SNAPSHOT_MAGIC);
+    ok &= native_to_network(&net.version, SNAPSHOT_VERSION);
+    ok &= native_to_network(&net.kind, VString<15>(kind));
+    ok &= native_to_network(&net.record_size, uint32_t(record_size));
+    ok &= native_to_network(&net.next_id, next_id);
+    ok &= native_to_network(&net.text_size, text_size);
+    ok &= native_to_network(&net.text_hash, hash);
+    assert (ok);
+    out.really_put(reinterpret_cast<const char *>(&net), sizeof(net));
+}
+} // namespace tmwa
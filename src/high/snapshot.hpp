@@ -0,0 +1,125 @@
+#pragma once
+//    snapshot.hpp - Binary snapshots of the flat-file databases.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#include "../ints/little.hpp"
+
+#include "../strings/xstring.hpp"
+
+#include "../proto-base/net-string.hpp"
+
+#include "../io/lock.hpp"
+#include "../io/mmap.hpp"
+
+
+namespace tmwa
+{
+// A snapshot is a header followed by fixed-size records, each of which
+// is one of the Net* structs from the protocol, so that loading one is
+// a bounded copy per record instead of a text parse.
+//
+// The text file stays the real database: a snapshot is written next to
+// it whenever the text file is rewritten, and remembers how long the
+// text file was then. Loading takes the snapshot and then reads only
+// what was appended to the text file since.
+
+/// How to load a database that has a snapshot configured.
+enum class SnapshotLoad
+{
+    /// The snapshot, then whatever was appended to the text file since.
+    NORMAL,
+    /// Only the text file, as if there were no snapshot.
+    TEXT,
+    /// Only the snapshot, even if the text file is missing.
+    SNAPSHOT,
+};
+
+struct NetSnapshotHeader
+{
+    Little32 magic;
+    Little32 version;
+    NetString<16> kind;
+    Little32 record_size;
+    Little32 next_id;
+    Little64 text_size;
+    Little64 text_hash;
+};
+static_assert(alignof(NetSnapshotHeader) == 1, "alignof(NetSnapshotHeader) == 1");
+
+class SnapshotReader
+{
+    io::MappedFile file;
+    size_t record_size;
+    size_t count;
+    uint64_t text_size;
+    uint32_t id;
+    bool skip_text;
+    bool valid;
+public:
+    SnapshotReader(ZString snapshot, ZString text, SnapshotLoad how,
+            XString kind, size_t record_size);
+
+    bool is_open() { return valid; }
+    size_t size() { return count; }
+    uint32_t next_id() { return id; }
+
+    /// The part of the mapped text file that the snapshot doesn't hold.
+    XString text_tail(io::MappedFile& text);
+
+    template<class N>
+    const N& get(size_t i)
+    {
+        static_assert(alignof(N) == 1, "snapshot records must not need alignment");
+        assert (valid && sizeof(N) == record_size && i < count);
+        const char *rec = file.data() + sizeof(NetSnapshotHeader) + i * record_size;
+        return *reinterpret_cast<const N *>(rec);
+    }
+};
+
+class SnapshotWriter
+{
+    io::WriteLock out;
+    size_t record_size;
+public:
+    SnapshotWriter(ZString snapshot, ZString text,
+            XString kind, size_t record_size, uint32_t next_id);
+
+    bool is_open() { return out.is_open(); }
+    uint64_t written() { return out.written(); }
+    __attribute__((warn_unused_result))
+    bool close() { return out.close(); }
+    /// Give up on this snapshot, e.g. because a record couldn't be
+    /// converted. Any older snapshot no longer matches the text file,
+    /// so the next load reads the text file instead.
+    void abandon() { out.abandon(); }
+
+    template<class N>
+    void put(const N& rec)
+    {
+        static_assert(alignof(N) == 1, "snapshot records must not need alignment");
+        assert (sizeof(N) == record_size);
+        out.really_put(reinterpret_cast<const char *>(&rec), sizeof(rec));
+    }
+};
+} // namespace tmwa
@@ -20,8 +20,10 @@
 
 #include "fwd.hpp"
 
+#include <cstddef>
 #include <cstdint>
 
+#include <functional>
 #include <type_traits>
 
 
@@ -101,6 +103,13 @@ namespace ints
         {
             return w._value;
         }
+
+        /// For HashMap.
+        template<class R>
+        size_t hash_key(Wrapped<R> w)
+        {
+            return std::hash<R>()(w._value);
+        }
     } // namespace wrapped
 } // namespace ints
 
@@ -0,0 +1,59 @@
+#include "chunk.hpp"
+//    io/chunk.cpp - Parse the lines of a file on several threads.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace io
+{
+    // Below this, starting a thread costs more than it saves.
+    constexpr size_t PARSE_CHUNK_SIZE = 1024 * 1024;
+
+    size_t parse_threads(size_t size)
+    {
+        size_t cpus = std::thread::hardware_concurrency();
+        if (!cpus)
+            cpus = 1;
+        return std::max<size_t>(1, std::min(cpus, size / PARSE_CHUNK_SIZE));
+    }
+
+    std::vector<XString> split_lines(XString text, size_t n)
+    {
+        std::vector<XString> pieces;
+        auto b = text.begin(), e = text.end();
+        for (size_t i = 1; i <= n && b != e; ++i)
+        {
+            auto cut = e;
+            if (i != n)
+            {
+                cut = std::max(b, text.begin() + text.size() / n * i);
+                cut = std::find(cut, e, '\n');
+                if (cut != e)
+                    ++cut;
+            }
+            pieces.push_back(text.xislice(b, cut));
+            b = cut;
+        }
+        return pieces;
+    }
+} // namespace io
+} // namespace tmwa
@@ -0,0 +1,101 @@
+#pragma once
+//    io/chunk.hpp - Parse the lines of a file on several threads.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "../strings/xstring.hpp"
+
+
+namespace tmwa
+{
+namespace io
+{
+    /// How many threads parse_lines() would use for this much text.
+    size_t parse_threads(size_t size);
+
+    /// Split text into at most n pieces of about the same size,
+    /// without splitting any line between two pieces.
+    std::vector<XString> split_lines(XString text, size_t n);
+
+    /// Call f on each line of text, without its line ending.
+    template<class F>
+    void each_line(XString text, F f)
+    {
+        auto b = text.begin(), e = text.end();
+        while (b != e)
+        {
+            auto nl = std::find(b, e, '\n');
+            XString line = text.xislice(b, nl);
+            if (line.endswith('\r'))
+                line = line.xrslice_h(1);
+            f(line);
+            b = nl == e ? e : nl + 1;
+        }
+    }
+
+    /// Parse every line of text into a T, then hand the results to
+    /// merge in file order, on the calling thread.
+    ///
+    /// parse(XString line, T *out) runs on several threads at once,
+    /// so it must not touch anything but the line and *out. Anything
+    /// that depends on earlier lines, or on global state, belongs in
+    /// merge(XString line, T& parsed).
+    ///
+    /// The lines must not be turned into an RString by parse, unless
+    /// text has no owner, since that would share the owner's refcount.
+    template<class T, class P, class M>
+    void parse_lines(XString text, P parse, M merge)
+    {
+        std::vector<XString> pieces = split_lines(text, parse_threads(text.size()));
+        std::vector<std::vector<T>> parsed(pieces.size());
+        auto work = [&pieces, &parsed, &parse](size_t i)
+        {
+            each_line(pieces[i], [&](XString line)
+            {
+                parsed[i].emplace_back();
+                parse(line, &parsed[i].back());
+            });
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < pieces.size(); ++i)
+            workers.emplace_back(work, i);
+        if (!pieces.empty())
+            work(0);
+        for (std::thread& t : workers)
+            t.join();
+
+        for (size_t i = 0; i < pieces.size(); ++i)
+        {
+            auto it = parsed[i].begin();
+            each_line(pieces[i], [&](XString line)
+            {
+                merge(line, *it);
+                ++it;
+            });
+            std::vector<T>().swap(parsed[i]);
+        }
+    }
+} // namespace io
+} // namespace tmwa
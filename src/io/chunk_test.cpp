@@ -0,0 +1,83 @@
+#include "chunk.hpp"
+//    io/chunk_test.cpp - Testsuite for parsing lines on several threads
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include "../strings/mstring.hpp"
+#include "../strings/astring.hpp"
+#include "../strings/literal.hpp"
+
+#include "cxxstdio.hpp"
+#include "extract.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+TEST(io, splitlines)
+{
+    XString text = "a\nbb\nccc\ndddd\n"_s;
+    std::vector<XString> pieces = io::split_lines(text, 3);
+    ASSERT_EQ(pieces.size(), 3u);
+    EXPECT_EQ(pieces[0], "a\nbb\n"_s);
+    EXPECT_EQ(pieces[1], "ccc\n"_s);
+    EXPECT_EQ(pieces[2], "dddd\n"_s);
+
+    pieces = io::split_lines("one line only"_s, 4);
+    ASSERT_EQ(pieces.size(), 1u);
+    EXPECT_EQ(pieces[0], "one line only"_s);
+
+    EXPECT_TRUE(io::split_lines(""_s, 4).empty());
+}
+
+TEST(io, eachline)
+{
+    std::vector<AString> lines;
+    io::each_line("a\r\n\nb"_s, [&](XString line) { lines.push_back(line); });
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(lines[0], "a"_s);
+    EXPECT_EQ(lines[1], ""_s);
+    EXPECT_EQ(lines[2], "b"_s);
+}
+
+TEST(io, parselines)
+{
+    MString buf;
+    for (int i = 0; i < 300000; ++i)
+        buf += STRPRINTF("%d\n"_fmt, i);
+    AString text = AString(buf);
+
+    int expected = 0;
+    bool ordered = true;
+    io::parse_lines<int>(text,
+            [](XString line, int *out)
+            {
+                if (!extract(line, out))
+                    *out = -1;
+            },
+            [&](XString, int& i)
+            {
+                ordered &= i == expected++;
+            });
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(expected, 300000);
+}
+} // namespace tmwa
@@ -99,6 +99,14 @@ namespace io
     {
         return ::pwritev(fd, iov, iovcnt, offset);
     }
+    off_t FD::lseek(off_t offset, int whence)
+    {
+        return ::lseek(fd, offset, whence);
+    }
+    int FD::fstat(struct stat *buf)
+    {
+        return ::fstat(fd, buf);
+    }
 
     int FD::close()
     {
@@ -109,6 +117,10 @@ namespace io
         }
         return ::close(fd);
     }
+    int FD::fsync()
+    {
+        return ::fsync(fd);
+    }
     int FD::shutdown(int how)
     {
         return ::shutdown(fd, how);
@@ -22,6 +22,7 @@
 
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 
 #include "../diagnostics.hpp"
 
@@ -83,8 +84,11 @@ namespace io
         ssize_t writev(const struct iovec *iov, int iovcnt);
         ssize_t preadv(const struct iovec *iov, int iovcnt, off_t offset);
         ssize_t pwritev(const struct iovec *iov, int iovcnt, off_t offset);
+        off_t lseek(off_t offset, int whence);
+        int fstat(struct stat *buf);
 
         int close();
+        int fsync();
         int shutdown(int);
         int getsockopt(int level, int optname, void *optval, socklen_t *optlen);
         int setsockopt(int level, int optname, const void *optval, socklen_t optlen);
@@ -34,6 +34,7 @@ namespace io
     class ReadFile;
     class WriteFile;
     class AppendFile;
+    class MappedFile;
     class LineReader;
     class LineCharReader;
     class Line;
@@ -69,14 +69,21 @@ namespace io
 
     WriteLock::WriteLock(RString fn, bool linebuffered)
     : WriteFile(get_lock_open(fn, &tmp_suffix), linebuffered), filename(fn)
+    , closed(false)
     {}
     WriteLock::~WriteLock()
     {
+        if (!closed && !close())
+            abort();
+    }
+    bool WriteLock::close()
+    {
+        closed = true;
         if (!WriteFile::close())
         {
             // leave partial file
             FPRINTF(stderr, "Warning: failed to write replacement for %s\n"_fmt, filename);
-            abort();
+            return false;
         }
 
         int n = backup_count;
@@ -91,6 +98,16 @@ namespace io
 
         AString tmpfile = STRPRINTF("%s_%d.tmp"_fmt, filename, tmp_suffix);
         rename(tmpfile.c_str(), filename.c_str());
+        return true;
+    }
+    void WriteLock::abandon()
+    {
+        closed = true;
+        // the partial file is removed either way
+        if (!WriteFile::close())
+            FPRINTF(stderr, "Warning: failed to finish %s_%d.tmp\n"_fmt, filename, tmp_suffix);
+        AString tmpfile = STRPRINTF("%s_%d.tmp"_fmt, filename, tmp_suffix);
+        unlink(tmpfile.c_str());
     }
 } // namespace io
 } // namespace tmwa
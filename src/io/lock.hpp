@@ -33,10 +33,17 @@ namespace io
     {
         RString filename;
         int tmp_suffix;
+        bool closed;
     public:
         WriteLock(RString filename, bool linebuffered=false);
         ~WriteLock();
-        bool close() = delete;
+        /// Finish writing and replace the file with what was written.
+        /// If that fails, the old file is left alone and the destructor
+        /// won't abort, unlike when close() isn't called at all.
+        __attribute__((warn_unused_result))
+        bool close();
+        /// Throw away what was written, leaving the old file alone.
+        void abandon();
     };
 } // namespace io
 } // namespace tmwa
@@ -0,0 +1,79 @@
+#include "mmap.hpp"
+//    io/mmap.cpp - Read-only mapping of a whole file.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <fcntl.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../strings/zstring.hpp"
+
+#include "../diagnostics.hpp"
+
+#include "fd.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace io
+{
+    MappedFile::MappedFile(ZString name)
+    : start(nullptr), len(0), opened(false)
+    {
+        FD fd = FD::open(name, O_RDONLY | O_CLOEXEC);
+        if (fd == FD())
+            return;
+        struct stat st;
+        if (fd.fstat(&st) == -1)
+        {
+            fd.close();
+            return;
+        }
+        len = st.st_size;
+        // mmap() refuses a length of 0, but an empty file is still a file
+        if (len)
+        {
+            void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd.uncast_dammit(), 0);
+            DIAG_PUSH();
+            DIAG_I(old_style_cast);
+            bool failed = p == MAP_FAILED;
+            DIAG_POP();
+            if (failed)
+            {
+                len = 0;
+                fd.close();
+                return;
+            }
+            madvise(p, len, MADV_SEQUENTIAL);
+            start = static_cast<const char *>(p);
+        }
+        // the mapping stays valid without the descriptor
+        fd.close();
+        opened = true;
+    }
+    MappedFile::~MappedFile()
+    {
+        if (start)
+            munmap(const_cast<char *>(start), len);
+    }
+} // namespace io
+} // namespace tmwa
@@ -0,0 +1,50 @@
+#pragma once
+//    io/mmap.hpp - Read-only mapping of a whole file.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <cstddef>
+
+
+namespace tmwa
+{
+namespace io
+{
+    class MappedFile
+    {
+    private:
+        const char *start;
+        size_t len;
+        bool opened;
+    public:
+        explicit
+        MappedFile(ZString name);
+
+        MappedFile& operator = (MappedFile&&) = delete;
+        MappedFile(MappedFile&&) = delete;
+        ~MappedFile();
+
+        const char *data() { return start; }
+        size_t size() { return len; }
+
+        bool is_open() { return opened; }
+    };
+} // namespace io
+} // namespace tmwa
@@ -0,0 +1,79 @@
+#include "mmap.hpp"
+//    io/mmap_test.cpp - Testsuite for read-only file mappings
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "../strings/xstring.hpp"
+#include "../strings/zstring.hpp"
+#include "../strings/literal.hpp"
+
+#include "fd.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+class TempFile
+{
+    char name[32] = "/tmp/tmwa-mmap-test-XXXXXX";
+public:
+    TempFile(XString content)
+    {
+        io::FD fd = io::FD::cast_dammit(mkstemp(name));
+        if (fd.write(content.data(), content.size()) != content.size())
+            name[0] = '\0';
+        fd.close();
+    }
+    ~TempFile()
+    {
+        unlink(name);
+    }
+    ZString path()
+    {
+        return ZString(strings::really_construct_from_a_pointer, name, nullptr);
+    }
+};
+
+TEST(io, mmapmissing)
+{
+    io::MappedFile mf("/nonexistent/tmwa-mmap-test"_s);
+    EXPECT_FALSE(mf.is_open());
+    EXPECT_EQ(mf.size(), 0u);
+}
+TEST(io, mmapempty)
+{
+    TempFile tf(""_s);
+    io::MappedFile mf(tf.path());
+    EXPECT_TRUE(mf.is_open());
+    EXPECT_EQ(mf.size(), 0u);
+}
+TEST(io, mmapcontent)
+{
+    TempFile tf("Hello\nWorld\n"_s);
+    io::MappedFile mf(tf.path());
+    ASSERT_TRUE(mf.is_open());
+    EXPECT_EQ(XString(mf.data(), mf.data() + mf.size(), nullptr), "Hello\nWorld\n"_s);
+}
+} // namespace tmwa
@@ -36,15 +36,15 @@ namespace tmwa
 namespace io
 {
     WriteFile::WriteFile(FD f, bool linebuffered)
-    : fd(f), lb(linebuffered), buflen(0)
+    : fd(f), lb(linebuffered), buflen(0), total(0)
     // only for debug-sanity
     , buf{}
     {}
     WriteFile::WriteFile(ZString name, bool linebuffered)
-    : fd(FD::open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666)), lb(linebuffered), buflen(0)
+    : fd(FD::open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666)), lb(linebuffered), buflen(0), total(0)
     {}
     WriteFile::WriteFile(const DirFd& dir, ZString name, bool linebuffered)
-    : fd(dir.open_fd(name, O_WRONLY | O_CREAT | O_TRUNC, 0666)), lb(linebuffered), buflen(0)
+    : fd(dir.open_fd(name, O_WRONLY | O_CREAT | O_TRUNC, 0666)), lb(linebuffered), buflen(0), total(0)
     {}
     WriteFile::~WriteFile()
     {
@@ -63,6 +63,7 @@ namespace io
     }
     void WriteFile::really_put(const char *dat, size_t len)
     {
+        total += len;
         if (len + buflen <= sizeof(buf))
         {
             std::copy(dat, dat + len, buf + buflen);
@@ -140,7 +141,7 @@ namespace io
             put('\n');
     }
 
-    bool WriteFile::close()
+    bool WriteFile::write_buffer()
     {
         size_t off = 0;
         while (off < buflen)
@@ -154,6 +155,19 @@ namespace io
             }
             off += rv;
         }
+        buflen = 0;
+        return true;
+    }
+
+    bool WriteFile::sync()
+    {
+        return write_buffer() && fd.fsync() == 0;
+    }
+
+    bool WriteFile::close()
+    {
+        if (!write_buffer())
+            return false;
 
         FD f = fd;
         fd = FD();
@@ -21,6 +21,7 @@
 #include "fwd.hpp"
 
 #include <cstdarg>
+#include <cstdint>
 
 #include "dir.hpp"
 #include "fd.hpp"
@@ -36,7 +37,10 @@ namespace io
         FD fd;
         bool lb;
         unsigned short buflen;
+        uint64_t total;
         char buf[4096];
+
+        bool write_buffer();
     public:
         explicit
         WriteFile(FD fd, bool linebuffered=false);
@@ -51,7 +55,12 @@ namespace io
         void put(char);
         void really_put(const char *dat, size_t len);
         void put_line(XString);
+        /// How many bytes have been put so far.
+        uint64_t written() { return total; }
 
+        /// Write out the buffer and wait for it to reach the disk.
+        __attribute__((warn_unused_result))
+        bool sync();
         __attribute__((warn_unused_result))
         bool close();
         bool is_open();
@@ -21,6 +21,9 @@
 #include "../generic/array.hpp"
 #include "../generic/db.hpp"
 
+#include "../high/save_thread.hpp"
+#include "../high/snapshot.hpp"
+
 #include "login.hpp"
 #include "login_conf.hpp"
 #include "login_lan_conf.hpp"
@@ -45,10 +48,29 @@ namespace tmwa
         Array<AuthFifo, AUTH_FIFO_SIZE> auth_fifo;
         // TODO replace with auto_fifo_it
         int auth_fifo_pos = 0;
-        std::vector<AuthData> auth_data;
+        // may still be shared with a save being written; see auth_edit()
+        std::vector<std::shared_ptr<AuthData>> auth_data;
+        // positions in auth_data, maintained by auth_index_add()/auth_delete()
+        HashMap<AccountName, size_t> auth_index_by_name;
+        HashMap<AccountId, size_t> auth_index_by_id;
+        // accounts changed or deleted since they were last written out
+        std::set<AccountId> auth_dirty;
+        // lines appended to the account file since it was last rewritten
+        size_t auth_journal_lines;
+        // auth_dirty as it was when the running save was taken;
+        // put back into auth_dirty if that save fails
+        std::set<AccountId> auth_saving;
+        // what auth_journal_lines becomes once that save is on disk
+        size_t auth_saving_lines;
+        SnapshotLoad snapshot_load = SnapshotLoad::NORMAL;
+        // set if --write-text was given, but the snapshot couldn't be loaded
+        bool snapshot_missing;
+        // set if the account file still holds passwords that were
+        // encrypted on load; the next save rewrites it
+        bool auth_plain_passwords;
         // TODO make this just be Map<AccountId, GmLevel>
         Map<AccountId, GM_Account> gm_account_db;
-        // For forked DB writes
-        pid_t pid = 0;
+        // writes the periodic saves, from a copy taken by check_auth_sync()
+        SaveThread save_thread;
     } // namespace login
 } // namespace tmwa
@@ -20,6 +20,8 @@
 
 #include "fwd.hpp"
 
+#include <memory>
+#include <set>
 #include <vector>
 
 #include "../net/timer.t.hpp"
@@ -41,8 +43,17 @@ namespace tmwa
         extern Session *login_session;
         extern Array<AuthFifo, AUTH_FIFO_SIZE> auth_fifo;
         extern int auth_fifo_pos;
-        extern std::vector<AuthData> auth_data;
+        extern std::vector<std::shared_ptr<AuthData>> auth_data;
+        extern HashMap<AccountName, size_t> auth_index_by_name;
+        extern HashMap<AccountId, size_t> auth_index_by_id;
+        extern std::set<AccountId> auth_dirty;
+        extern size_t auth_journal_lines;
+        extern std::set<AccountId> auth_saving;
+        extern size_t auth_saving_lines;
+        extern SnapshotLoad snapshot_load;
+        extern bool snapshot_missing;
+        extern bool auth_plain_passwords;
         extern Map<AccountId, GM_Account> gm_account_db;
-        extern pid_t pid;
+        extern SaveThread save_thread;
     } // namespace login
 } // namespace tmwa
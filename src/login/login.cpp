@@ -21,16 +21,13 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <sys/wait.h>
-
 #include <netdb.h>
 #include <unistd.h>
 
-#include <sys/resource.h>
-
 #include <ctime>
 
 #include <algorithm>
+#include <memory>
 #include <set>
 
 #include "../ints/udl.hpp"
@@ -44,9 +41,11 @@
 #include "../generic/db.hpp"
 #include "../generic/random.hpp"
 
+#include "../io/chunk.hpp"
 #include "../io/cxxstdio.hpp"
 #include "../io/extract.hpp"
 #include "../io/lock.hpp"
+#include "../io/mmap.hpp"
 #include "../io/read.hpp"
 #include "../io/span.hpp"
 #include "../io/tty.hpp"
@@ -64,11 +63,14 @@
 #include "../proto2/login-admin.hpp"
 #include "../proto2/login-char.hpp"
 #include "../proto2/login-user.hpp"
+#include "../proto2/net-GlobalReg.hpp"
 
 #include "../high/core.hpp"
 #include "../high/extract_mmo.hpp"
 #include "../high/md5more.hpp"
 #include "../high/mmo.hpp"
+#include "../high/save_thread.hpp"
+#include "../high/snapshot.hpp"
 #include "../high/utils.hpp"
 
 #include "../wire/packets.hpp"
@@ -112,8 +114,58 @@ bool extract(XString str, login::ACO *aco)
     }
     return false;
 }
+
+bool native_to_network(NetAuthData *network, const login::AuthData& native)
+{
+    bool rv = true;
+    rv &= native_to_network(&network->account_id, native.account_id);
+    rv &= native_to_network(&network->sex, native.sex);
+    rv &= native_to_network(&network->userid, native.userid);
+    rv &= native_to_network(&network->pass, native.pass);
+    rv &= native_to_network(&network->lastlogin, native.lastlogin);
+    rv &= native_to_network(&network->logincount, native.logincount);
+    rv &= native_to_network(&network->state, native.state);
+    rv &= native_to_network(&network->email, native.email);
+    rv &= native_to_network(&network->error_message, native.error_message);
+    rv &= native_to_network(&network->ban_until_time, native.ban_until_time);
+    rv &= native_to_network(&network->last_ip, native.last_ip);
+    rv &= native_to_network(&network->memo, native.memo);
+    rv &= native_to_network(&network->account_reg2_num, native.account_reg2_num);
+    rv &= native_to_network(&network->account_reg2, native.account_reg2);
+    return rv;
+}
+bool network_to_native(login::AuthData *native, const NetAuthData& network)
+{
+    bool rv = true;
+    rv &= network_to_native(&native->account_id, network.account_id);
+    rv &= network_to_native(&native->sex, network.sex);
+    rv &= network_to_native(&native->userid, network.userid);
+    rv &= network_to_native(&native->pass, network.pass);
+    rv &= network_to_native(&native->lastlogin, network.lastlogin);
+    rv &= network_to_native(&native->logincount, network.logincount);
+    rv &= network_to_native(&native->state, network.state);
+    rv &= network_to_native(&native->email, network.email);
+    rv &= network_to_native(&native->error_message, network.error_message);
+    rv &= network_to_native(&native->ban_until_time, network.ban_until_time);
+    rv &= network_to_native(&native->last_ip, network.last_ip);
+    rv &= network_to_native(&native->memo, network.memo);
+    rv &= network_to_native(&native->account_reg2_num, network.account_reg2_num);
+    rv &= network_to_native(&native->account_reg2, network.account_reg2);
+    return rv && 0 <= native->account_reg2_num
+        && native->account_reg2_num <= ACCOUNT_REG2_NUM;
+}
+
 namespace login
 {
+constexpr size_t AUTH_COMPACT_LINES = 4096;
+
+/// One line of account_filename, as parsed by a loader thread.
+struct AuthLine
+{
+    enum { COMMENT, NEWID, DELETED, ACCOUNT, BROKEN } kind;
+    AuthData ad {};
+};
+
 struct mmo_account
 {
     AccountName userid;
@@ -326,19 +378,122 @@ bool check_ladminip(IP4Address ip)
 //   (return account pointer or nullptr (if not found))
 //-----------------------------------------------
 static
-AuthData *search_account(AccountName account_name)
+const AuthData *search_account(AccountName account_name)
 {
-    for (AuthData& ad : auth_data)
+    Option<Borrowed<size_t>> idx = auth_index_by_name.search(account_name);
+    OMATCH_BEGIN_SOME (i, idx)
     {
-        {
-            if (ad.userid == account_name)
-                return &ad;
-        }
+        return auth_data[*i].get();
+    }
+    OMATCH_END ();
+    return nullptr;
+}
+
+static
+const AuthData *search_account_id(AccountId account_id)
+{
+    Option<Borrowed<size_t>> idx = auth_index_by_id.search(account_id);
+    OMATCH_BEGIN_SOME (i, idx)
+    {
+        return auth_data[*i].get();
     }
+    OMATCH_END ();
+    return nullptr;
+}
+
+//-----------------------------------------------
+// Get the account at auth_data[idx] to change it.
+//   A save that is still being written may share it;
+//   then it gets its own copy first, so the save
+//   keeps the account as it was when it was taken.
+//-----------------------------------------------
+static
+AuthData *auth_edit(size_t idx)
+{
+    std::shared_ptr<AuthData>& ad = auth_data[idx];
+    if (ad.use_count() > 1)
+        ad = std::make_shared<AuthData>(*ad);
+    return ad.get();
+}
 
+//-----------------------------------------------
+// Search an account to change it
+//   (return account pointer or nullptr (if not found))
+//-----------------------------------------------
+static
+AuthData *edit_account(AccountName account_name)
+{
+    Option<Borrowed<size_t>> idx = auth_index_by_name.search(account_name);
+    OMATCH_BEGIN_SOME (i, idx)
+    {
+        return auth_edit(*i);
+    }
+    OMATCH_END ();
     return nullptr;
 }
 
+static
+AuthData *edit_account_id(AccountId account_id)
+{
+    Option<Borrowed<size_t>> idx = auth_index_by_id.search(account_id);
+    OMATCH_BEGIN_SOME (i, idx)
+    {
+        return auth_edit(*i);
+    }
+    OMATCH_END ();
+    return nullptr;
+}
+
+//-----------------------------------------------
+// Index the account at auth_data[idx].
+// If a name or id is duplicated in the file, the first one wins,
+// the same as when these were found by a linear search.
+//-----------------------------------------------
+static
+void auth_index_add(size_t idx)
+{
+    const AuthData& ad = *auth_data[idx];
+    if (auth_index_by_name.search(ad.userid).is_none())
+        auth_index_by_name.insert(ad.userid, idx);
+    if (auth_index_by_id.search(ad.account_id).is_none())
+        auth_index_by_id.insert(ad.account_id, idx);
+}
+
+static
+void auth_index_remove(const AuthData *ad)
+{
+    Option<Borrowed<size_t>> name_idx = auth_index_by_name.search(ad->userid);
+    OMATCH_BEGIN_SOME (i, name_idx)
+    {
+        if (auth_data[*i].get() == ad)
+            auth_index_by_name.erase(ad->userid);
+    }
+    OMATCH_END ();
+    Option<Borrowed<size_t>> id_idx = auth_index_by_id.search(ad->account_id);
+    OMATCH_BEGIN_SOME (i, id_idx)
+    {
+        if (auth_data[*i].get() == ad)
+            auth_index_by_id.erase(ad->account_id);
+    }
+    OMATCH_END ();
+}
+
+//-----------------------------------------------
+// Delete an account. It stays in auth_data with a blank name and id,
+// so that the positions of the others do not change. The next save
+// appends a tombstone for it; the account's line only leaves the file
+// at the next compaction, and the blank entry stays until a restart.
+// ad must come from edit_account() or edit_account_id().
+//-----------------------------------------------
+static
+void auth_delete(AuthData *ad)
+{
+    auth_dirty.insert(ad->account_id);
+    auth_index_remove(ad);
+    ad->userid = AccountName();
+    ad->account_id = AccountId();
+}
+
 //--------------------------------------------------------
 // Create a string to save the account in the account file
 //--------------------------------------------------------
@@ -374,7 +529,7 @@ AString mmo_auth_tostr(const AuthData *p)
             p->memo,
             p->ban_until_time);
 
-    assert (p->account_reg2_num < ACCOUNT_REG2_NUM);
+    assert (p->account_reg2_num <= ACCOUNT_REG2_NUM);
     for (int i = 0; i < p->account_reg2_num; i++)
         if (p->account_reg2[i].str)
             str += STRPRINTF("%s,%d "_fmt,
@@ -414,29 +569,6 @@ bool impl_extract(XString line, AuthData *ad)
         return false;
     if (!(ad->account_id < END_ACCOUNT_NUM))
         return false;
-    // TODO replace *every* lookup with a map lookup
-    static std::set<AccountId> seen_ids;
-    static std::set<AccountName> seen_names;
-    // we don't have to worry about deleted characters,
-    // this is only called during startup
-    auto _seen_id = seen_ids.insert(ad->account_id);
-    if (!_seen_id.second)
-        return false;
-    auto _seen_name = seen_names.insert(ad->userid);
-    if (!_seen_name.second)
-    {
-        seen_ids.erase(_seen_id.first);
-        return false;
-    }
-    // If a password is not encrypted, we encrypt it now.
-    // A password beginning with ! and - in the memo field is our magic
-    if (!ad->pass.startswith('!') && ad->memo.startswith('-'))
-    {
-        XString pass = ad->pass;
-        AccountPass plain = stringish<AccountPass>(pass);
-        ad->pass = MD5_saltcrypt(plain, make_salt());
-        ad->memo = '!';
-    }
 
     if (sex.size() != 1)
         return false;
@@ -467,8 +599,31 @@ int mmo_auth_init(void)
 {
     int gm_count = 0;
 
-    io::ReadFile in(login_conf.account_filename);
-    if (!in.is_open())
+    SnapshotReader snap(login_conf.account_bin, login_conf.account_filename, snapshot_load,
+            "account"_s, sizeof(NetAuthData));
+    if (snapshot_load == SnapshotLoad::SNAPSHOT && !snap.is_open())
+        snapshot_missing = true;
+    size_t record_count = 0;
+    auth_data.reserve(snap.size());
+    for (size_t i = 0; i < snap.size(); ++i)
+    {
+        AuthData ad {};
+        if (!network_to_native(&ad, snap.get<NetAuthData>(i))
+                || search_account_id(ad.account_id)
+                || search_account(ad.userid))
+        {
+            LOGIN_LOG("Account %zu skipped in %s\n"_fmt, i, login_conf.account_bin);
+            continue;
+        }
+        auth_data.push_back(std::make_shared<AuthData>(ad));
+        auth_index_add(auth_data.size() - 1);
+        record_count++;
+    }
+    if (snap.is_open() && account_id_count < wrap<AccountId>(snap.next_id()))
+        account_id_count = wrap<AccountId>(snap.next_id());
+
+    io::MappedFile text(login_conf.account_filename);
+    if (!text.is_open() && !snap.is_open())
     {
         // no account file -> no account -> no login, including char-server (ERROR)
         // not anymore! :-)
@@ -477,42 +632,102 @@ int mmo_auth_init(void)
         return 0;
     }
 
-    AString line;
-    while (in.getline(line))
-    {
-        if (is_comment(line))
-            continue;
-        if (std::find_if(line.begin(), line.end(),
-                    [](unsigned char c) { return c < ' ' && c != '\t'; }
-                    ) != line.end())
-            continue;
-
-        AuthData ad {};
-        if (!extract(line, &ad))
-        {
-            if (extract(line, record<'\t'>(&ad.account_id, "%newid%"_s)))
+    // Accounts saved since the file was last rewritten are appended
+    // to it, so a later line for the same account id replaces an
+    // earlier one, and a "%deleted%" line removes it.
+    std::vector<AccountId> encrypted;
+    io::parse_lines<AuthLine>(snap.text_tail(text),
+            [](XString line, AuthLine *al)
             {
-                if (account_id_count < ad.account_id)
-                    account_id_count = ad.account_id;
-            }
-            else
-                LOGIN_LOG("Account skipped\n%s"_fmt, line);
-            continue;
-        }
-
-        auth_data.push_back(ad);
+                AuthData *ad = &al->ad;
+                if (is_comment(line)
+                        || std::find_if(line.begin(), line.end(),
+                            [](unsigned char c) { return c < ' ' && c != '\t'; }
+                            ) != line.end())
+                    al->kind = AuthLine::COMMENT;
+                else if (extract(line, ad))
+                    al->kind = AuthLine::ACCOUNT;
+                else if (extract(line, record<'\t'>(&ad->account_id, "%newid%"_s)))
+                    al->kind = AuthLine::NEWID;
+                else if (extract(line, record<'\t'>(&ad->account_id, "%deleted%"_s)))
+                    al->kind = AuthLine::DELETED;
+                else
+                    al->kind = AuthLine::BROKEN;
+            },
+            [&record_count, &encrypted](XString line, AuthLine& al)
+            {
+                AuthData& ad = al.ad;
+                switch (al.kind)
+                {
+                case AuthLine::COMMENT:
+                    return;
+                case AuthLine::NEWID:
+                    if (account_id_count < ad.account_id)
+                        account_id_count = ad.account_id;
+                    return;
+                case AuthLine::DELETED:
+                    record_count++;
+                    if (account_id_count < next(ad.account_id))
+                        account_id_count = next(ad.account_id);
+                    if (AuthData *old = edit_account_id(ad.account_id))
+                        auth_delete(old);
+                    return;
+                case AuthLine::ACCOUNT:
+                {
+                    Option<Borrowed<size_t>> old_idx = auth_index_by_id.search(ad.account_id);
+                    const AuthData *old = search_account_id(ad.account_id);
+                    const AuthData *same_name = search_account(ad.userid);
+                    if (same_name && same_name != old)
+                        break;
+                    record_count++;
+                    if (account_id_count < next(ad.account_id))
+                        account_id_count = next(ad.account_id);
+
+                    // If a password is not encrypted, we encrypt it now.
+                    // A password beginning with ! and - in the memo field is our magic
+                    // (not done by extract, since make_salt() isn't thread-safe)
+                    if (!ad.pass.startswith('!') && ad.memo.startswith('-'))
+                    {
+                        XString pass = ad.pass;
+                        AccountPass plain = stringish<AccountPass>(pass);
+                        ad.pass = MD5_saltcrypt(plain, make_salt());
+                        ad.memo = '!';
+                        encrypted.push_back(ad.account_id);
+                    }
 
-        if (isGM(ad.account_id))
+                    OMATCH_BEGIN_SOME (i, old_idx)
+                    {
+                        size_t idx = *i;
+                        auth_index_remove(old);
+                        auth_data[idx] = std::make_shared<AuthData>(ad);
+                        auth_index_add(idx);
+                        return;
+                    }
+                    OMATCH_END ();
+                    auth_data.push_back(std::make_shared<AuthData>(ad));
+                    auth_index_add(auth_data.size() - 1);
+                    return;
+                }
+                case AuthLine::BROKEN:
+                    break;
+                }
+                LOGIN_LOG("Account skipped\n%s"_fmt, AString(line));
+            });
+    auth_journal_lines = record_count - auth_index_by_id.size();
+    auth_dirty.clear();
+    // Nothing else would write the encrypted passwords out, and the
+    // plain ones must not wait on disk for some far-off compaction.
+    auth_dirty.insert(encrypted.begin(), encrypted.end());
+    auth_plain_passwords = !encrypted.empty();
+
+    for (const std::shared_ptr<AuthData>& ad : auth_data)
+        if (ad->account_id && isGM(ad->account_id))
             gm_count++;
 
-        if (account_id_count < next(ad.account_id))
-            account_id_count = next(ad.account_id);
-    }
-
     AString str = STRPRINTF("%s has %zu accounts (%d GMs)\n"_fmt,
-            login_conf.account_filename, auth_data.size(), gm_count);
+            login_conf.account_filename, auth_index_by_id.size(), gm_count);
     PRINTF("mmo_auth_init: %s\n"_fmt, str);
-    LOGIN_LOG("%s\n"_fmt, line);
+    LOGIN_LOG("%s\n"_fmt, str);
 
     return 0;
 }
@@ -521,47 +736,128 @@ int mmo_auth_init(void)
 // Writing of the accounts database file
 //------------------------------------------
 static
-void mmo_auth_sync(void)
+bool mmo_auth_sync(const std::vector<std::shared_ptr<AuthData>>& accounts, AccountId next_id, uint64_t *bytes)
 {
-    io::WriteLock fp(login_conf.account_filename);
+    {
+        io::WriteLock fp(login_conf.account_filename);
 
-    if (!fp.is_open())
+        if (!fp.is_open())
+        {
+            PRINTF("uh-oh - unable to save accounts\n"_fmt);
+            return false;
+        }
+        FPRINTF(fp,
+                "// Accounts file: here are saved all information about the accounts.\n"_fmt);
+        FPRINTF(fp,
+                "// Structure: ID, account name, password, last login time, sex, # of logins, state, email, error message for state 7, validity time (unused), last (accepted) login ip, memo field, ban timestamp, repeated(register text, register value)\n"_fmt);
+        FPRINTF(fp, "// Some explanations:\n"_fmt);
+        FPRINTF(fp,
+                "//   account name    : between 4 to 23 char for a normal account (standard client can't send less than 4 char).\n"_fmt);
+        FPRINTF(fp, "//   account password: between 4 to 23 char\n"_fmt);
+        FPRINTF(fp,
+                "//   sex             : M or F for normal accounts, S for server accounts\n"_fmt);
+        FPRINTF(fp,
+                "//   state           : 0: account is ok, 1 to 256: error code of packet 0x006a + 1\n"_fmt);
+        FPRINTF(fp,
+                "//   email           : between 3 to 39 char (a@a.com is like no email)\n"_fmt);
+        FPRINTF(fp,
+                "//   error message   : text for the state 7: 'Your are Prohibited to login until <text>'. Max 19 char\n"_fmt);
+        FPRINTF(fp,
+                "//   valitidy time   : 0: unlimited account, <other value>: date calculated by addition of 1/1/1970 + value (number of seconds since the 1/1/1970)\n"_fmt);
+        FPRINTF(fp, "//   memo field      : max 254 char\n"_fmt);
+        FPRINTF(fp,
+                "//   ban time        : 0: no ban, <other value>: banned until the date: date calculated by addition of 1/1/1970 + value (number of seconds since the 1/1/1970)\n"_fmt);
+        for (const std::shared_ptr<AuthData>& ad : accounts)
+        {
+            if (!ad->account_id)
+                continue;
+
+            AString line = mmo_auth_tostr(ad.get());
+            fp.put_line(line);
+        }
+        FPRINTF(fp, "%d\t%%newid%%\n"_fmt, next_id);
+        *bytes += fp.written();
+        if (!fp.close())
+        {
+            PRINTF("uh-oh - unable to save accounts\n"_fmt);
+            return false;
+        }
+    }
+
+    if (!login_conf.account_bin)
+        return true;
+    SnapshotWriter snap(login_conf.account_bin, login_conf.account_filename,
+            "account"_s, sizeof(NetAuthData), unwrap<AccountId>(next_id));
+    if (!snap.is_open())
     {
         PRINTF("uh-oh - unable to save accounts\n"_fmt);
-        return;
+        return false;
     }
-    FPRINTF(fp,
-            "// Accounts file: here are saved all information about the accounts.\n"_fmt);
-    FPRINTF(fp,
-            "// Structure: ID, account name, password, last login time, sex, # of logins, state, email, error message for state 7, validity time (unused), last (accepted) login ip, memo field, ban timestamp, repeated(register text, register value)\n"_fmt);
-    FPRINTF(fp, "// Some explanations:\n"_fmt);
-    FPRINTF(fp,
-            "//   account name    : between 4 to 23 char for a normal account (standard client can't send less than 4 char).\n"_fmt);
-    FPRINTF(fp, "//   account password: between 4 to 23 char\n"_fmt);
-    FPRINTF(fp,
-            "//   sex             : M or F for normal accounts, S for server accounts\n"_fmt);
-    FPRINTF(fp,
-            "//   state           : 0: account is ok, 1 to 256: error code of packet 0x006a + 1\n"_fmt);
-    FPRINTF(fp,
-            "//   email           : between 3 to 39 char (a@a.com is like no email)\n"_fmt);
-    FPRINTF(fp,
-            "//   error message   : text for the state 7: 'Your are Prohibited to login until <text>'. Max 19 char\n"_fmt);
-    FPRINTF(fp,
-            "//   valitidy time   : 0: unlimited account, <other value>: date calculated by addition of 1/1/1970 + value (number of seconds since the 1/1/1970)\n"_fmt);
-    FPRINTF(fp, "//   memo field      : max 254 char\n"_fmt);
-    FPRINTF(fp,
-            "//   ban time        : 0: no ban, <other value>: banned until the date: date calculated by addition of 1/1/1970 + value (number of seconds since the 1/1/1970)\n"_fmt);
-    for (const AuthData& ad : auth_data)
+    for (const std::shared_ptr<AuthData>& ad : accounts)
     {
-        if (!ad.account_id)
+        if (!ad->account_id)
             continue;
 
-        AString line = mmo_auth_tostr(&ad);
-        fp.put_line(line);
+        NetAuthData net;
+        if (!native_to_network(&net, *ad))
+        {
+            // leaving it out would lose it on the next load
+            PRINTF("uh-oh - account %d can't go in %s, not writing it\n"_fmt,
+                    ad->account_id, login_conf.account_bin);
+            snap.abandon();
+            return true;
+        }
+        snap.put(net);
     }
-    FPRINTF(fp, "%d\t%%newid%%\n"_fmt, account_id_count);
+    *bytes += snap.written();
+    if (!snap.close())
+    {
+        PRINTF("uh-oh - unable to save accounts\n"_fmt);
+        return false;
+    }
+    return true;
 }
 
+//------------------------------------------
+// Append just the accounts changed since the last save,
+// and make sure they are on disk before returning.
+//------------------------------------------
+static
+bool mmo_auth_append(const std::vector<std::shared_ptr<AuthData>>& accounts,
+        const std::vector<AccountId>& deleted, uint64_t *bytes)
+{
+    if (accounts.empty() && deleted.empty())
+        return true;
+    io::AppendFile fp(login_conf.account_filename);
+    if (!fp.is_open())
+    {
+        PRINTF("uh-oh - unable to save accounts\n"_fmt);
+        return false;
+    }
+    for (const std::shared_ptr<AuthData>& ad : accounts)
+        fp.put_line(mmo_auth_tostr(ad.get()));
+    for (AccountId aid : deleted)
+        FPRINTF(fp, "%d\t%%deleted%%\n"_fmt, aid);
+    *bytes += fp.written();
+    if (!fp.sync())
+    {
+        PRINTF("uh-oh - unable to save accounts\n"_fmt);
+        return false;
+    }
+    return true;
+}
+
+/// What one periodic save writes, taken from auth_data.
+struct AuthSave
+{
+    bool compact;
+    // every account if compact, else just the changed ones;
+    // shared with auth_data until auth_edit() copies them
+    std::vector<std::shared_ptr<AuthData>> accounts;
+    std::vector<AccountId> deleted;
+    AccountId next_id;
+};
+
 // We want to sync the DB to disk as little as possible as it's fairly
 // resource intensive. therefore most player-triggerable events that
 // update the account DB will not immideately trigger a save. Instead
@@ -570,34 +866,77 @@ void mmo_auth_sync(void)
 static
 void check_auth_sync(TimerData *, tick_t)
 {
-    if (pid != 0)
+    bool failed = false;
+    SaveReport report;
+    if (save_thread.finished(&report))
     {
-        int status;
-        pid_t temp = waitpid(pid, &status, WNOHANG);
+        failed = !report.ok;
+        LOGIN_LOG("Saved %s%zu bytes: copy took %dus, on disk %dms later.\n"_fmt,
+                failed ? "(with errors) "_s : ""_s,
+                static_cast<size_t>(report.bytes_written),
+                static_cast<int>(report.snapshot_time.count()),
+                static_cast<int>(report.save_lag.count()));
+        // Only now are the saved changes known to be on disk.
+        if (failed)
+            auth_dirty.insert(auth_saving.begin(), auth_saving.end());
+        else
+            auth_journal_lines = auth_saving_lines;
+        auth_saving.clear();
+    }
+    // The changes keep piling up in auth_dirty until it is done.
+    if (save_thread.busy())
+        return;
 
-        // Need to check status too?
-        if (temp == 0)
+    save_clock::time_point start = save_clock::now();
+
+    // Usually only the changed accounts need to be appended. Once the
+    // appended lines outnumber the accounts (or AUTH_COMPACT_LINES,
+    // whichever is more), if the last save failed, or if it still holds
+    // plain-text passwords, the whole file is rewritten instead.
+    std::shared_ptr<AuthSave> save = std::make_shared<AuthSave>();
+    save->compact = failed || auth_plain_passwords
+        || auth_journal_lines + auth_dirty.size()
+        > std::max(AUTH_COMPACT_LINES, auth_index_by_id.size());
+    if (!save->compact && auth_dirty.empty())
+        return;
+    auth_saving.swap(auth_dirty);
+    if (save->compact)
+    {
+        save->accounts = auth_data;
+        auth_saving_lines = 0;
+        // if this fails, the next save is a compaction anyway
+        auth_plain_passwords = false;
+    }
+    else
+    {
+        for (AccountId aid : auth_saving)
         {
-            return;
+            Option<Borrowed<size_t>> idx = auth_index_by_id.search(aid);
+            OMATCH_BEGIN (idx)
+            {
+                OMATCH_CASE_SOME (i)
+                {
+                    save->accounts.push_back(auth_data[*i]);
+                }
+                OMATCH_CASE_NONE ()
+                {
+                    save->deleted.push_back(aid);
+                }
+            }
+            OMATCH_END ();
         }
+        auth_saving_lines = auth_journal_lines + auth_saving.size();
     }
+    save->next_id = account_id_count;
 
-    // This can take a lot of time. Fork a child to handle the work and return at once
-    // If we're unable to fork just continue running the function normally
-    if ((pid = fork()) > 0)
-        return;
-
-    // If we're a child, run as a lower priority process
-    if (pid == 0)
-        setpriority(PRIO_PROCESS, getpid(), 10);
-
-    mmo_auth_sync();
-
-    // If we're a child we should suicide now.
-    if (pid == 0)
-        _exit(0);
-
-    return;
+    save_thread.save(
+            [save](uint64_t *bytes)
+            {
+                return save->compact
+                    ? mmo_auth_sync(save->accounts, save->next_id, bytes)
+                    : mmo_auth_append(save->accounts, save->deleted, bytes);
+            },
+            start);
 }
 
 
@@ -615,13 +954,15 @@ void send_GM_accounts(Session *only=nullptr)
 {
     std::vector<Packet_Repeat<0x2732>> tail;
 
-    for (const AuthData& ad : auth_data)
+    for (auto& pair : gm_account_db)
     {
         // send only existing accounts. We can not create a GM account when server is online.
-        if (GmLevel GM_value = isGM(ad.account_id))
+        if (!search_account_id(pair.first))
+            continue;
+        if (GmLevel GM_value = isGM(pair.first))
         {
             Packet_Repeat<0x2732> item;
-            item.account_id = ad.account_id;
+            item.account_id = pair.first;
             item.gm_level = GM_value;
             tail.push_back(item);
         }
@@ -688,7 +1029,9 @@ AccountId mmo_auth_new(struct mmo_account *account, SEX sex, AccountEmail email)
     ad.last_ip = IP4Address();
     ad.memo = "!"_s;
     ad.account_reg2_num = 0;
-    auth_data.push_back(ad);
+    auth_data.push_back(std::make_shared<AuthData>(ad));
+    auth_index_add(auth_data.size() - 1);
+    auth_dirty.insert(ad.account_id);
 
     return ad.account_id;
 }
@@ -714,7 +1057,7 @@ int mmo_auth(struct mmo_account *account, Session *s)
     }
 
     // Strict account search
-    AuthData *ad = search_account(account->userid);
+    AuthData *ad = edit_account(account->userid);
 
     if (ad)
     {
@@ -795,7 +1138,7 @@ int mmo_auth(struct mmo_account *account, Session *s)
             LOGIN_LOG("Account creation and authentification accepted (account %s (id: %d), sex: %c, connection with _F/_M, ip: %s)\n"_fmt,
                     account->userid, new_id,
                     new_account_sex, ip);
-            ad = &auth_data.back();
+            ad = auth_data.back().get();
         }
     }
 
@@ -810,6 +1153,7 @@ int mmo_auth(struct mmo_account *account, Session *s)
     account->sex = ad->sex;
     ad->last_ip = ip;
     ad->logincount++;
+    auth_dirty.insert(ad->account_id);
 
     return -1;                  // account OK
 }
@@ -888,33 +1232,30 @@ void parse_fromchar(Session *s)
                             auth_fifo[i].delflag = 1;
                             LOGIN_LOG("Char-server '%s': authentification of the account %d accepted (ip: %s).\n"_fmt,
                                     server[id].name, acc, ip);
-                            for (const AuthData& ad : auth_data)
+                            if (const AuthData *adp = search_account_id(acc))
                             {
-                                if (ad.account_id == acc)
+                                const AuthData& ad = *adp;
+                                Packet_Head<0x2729> head_29;
+                                head_29.account_id = acc;
+                                std::vector<Packet_Repeat<0x2729>> repeat_29;
+                                int j;
+                                for (j = 0;
+                                     j < ad.account_reg2_num;
+                                     j++)
                                 {
-                                    Packet_Head<0x2729> head_29;
-                                    head_29.account_id = acc;
-                                    std::vector<Packet_Repeat<0x2729>> repeat_29;
-                                    int j;
-                                    for (j = 0;
-                                         j < ad.account_reg2_num;
-                                         j++)
-                                    {
-                                        Packet_Repeat<0x2729> item;
-                                        item.name = ad.account_reg2[j].str;
-                                        item.value = ad.account_reg2[j].value;
-                                        repeat_29.push_back(item);
-                                    }
-                                    send_vpacket<0x2729, 8, 36>(s, head_29, repeat_29);
+                                    Packet_Repeat<0x2729> item;
+                                    item.name = ad.account_reg2[j].str;
+                                    item.value = ad.account_reg2[j].value;
+                                    repeat_29.push_back(item);
+                                }
+                                send_vpacket<0x2729, 8, 36>(s, head_29, repeat_29);
 
-                                    Packet_Fixed<0x2713> fixed_13;
-                                    fixed_13.account_id = acc;
-                                    fixed_13.invalid = 0;
-                                    fixed_13.email = ad.email;
+                                Packet_Fixed<0x2713> fixed_13;
+                                fixed_13.account_id = acc;
+                                fixed_13.invalid = 0;
+                                fixed_13.email = ad.email;
 
-                                    send_fpacket<0x2713, 51>(s, fixed_13);
-                                    break;
-                                }
+                                send_fpacket<0x2713, 51>(s, fixed_13);
                             }
                             break;
                         }
@@ -959,22 +1300,20 @@ void parse_fromchar(Session *s)
                     break;
 
                 AccountId account_id = fixed.account_id;
-                for (const AuthData& ad : auth_data)
+                if (const AuthData *adp = search_account_id(account_id))
                 {
-                    if (ad.account_id == account_id)
-                    {
-                        LOGIN_LOG("Char-server '%s': e-mail of the account %d found (ip: %s).\n"_fmt,
-                                server[id].name, account_id, ip);
-
-                        Packet_Fixed<0x2717> fixed_17;
-                        fixed_17.account_id = account_id;
-                        fixed_17.email = ad.email;
-
-                        send_fpacket<0x2717, 50>(s, fixed_17);
-                        if (rv != RecvResult::Complete)
-                            break;
-                        goto x2716_end;
-                    }
+                    const AuthData& ad = *adp;
+                    LOGIN_LOG("Char-server '%s': e-mail of the account %d found (ip: %s).\n"_fmt,
+                            server[id].name, account_id, ip);
+
+                    Packet_Fixed<0x2717> fixed_17;
+                    fixed_17.account_id = account_id;
+                    fixed_17.email = ad.email;
+
+                    send_fpacket<0x2717, 50>(s, fixed_17);
+                    if (rv != RecvResult::Complete)
+                        break;
+                    goto x2716_end;
                 }
                 LOGIN_LOG("Char-server '%s': e-mail of the account %d NOT found (ip: %s).\n"_fmt,
                         server[id].name, account_id, ip);
@@ -1092,24 +1431,23 @@ void parse_fromchar(Session *s)
                                 server[id].name, acc, ip);
                     else
                     {
-                        for (AuthData& ad : auth_data)
+                        if (AuthData *adp = edit_account_id(acc))
                         {
-                            if (ad.account_id == acc)
+                            AuthData& ad = *adp;
+                            if (ad.email == actual_email)
                             {
-                                if (ad.email == actual_email)
-                                {
-                                    ad.email = new_email;
-                                    LOGIN_LOG("Char-server '%s': Modify an e-mail on an account (@email GM command) (account: %d (%s), new e-mail: %s, ip: %s).\n"_fmt,
-                                            server[id].name, acc,
-                                            ad.userid, new_email, ip);
-                                }
-                                else
-                                    LOGIN_LOG("Char-server '%s': Attempt to modify an e-mail on an account (@email GM command), but actual e-mail is incorrect (account: %d (%s), actual e-mail: %s, proposed e-mail: %s, ip: %s).\n"_fmt,
-                                            server[id].name, acc,
-                                            ad.userid,
-                                            ad.email, actual_email, ip);
-                                goto x2722_out;
+                                ad.email = new_email;
+                                auth_dirty.insert(ad.account_id);
+                                LOGIN_LOG("Char-server '%s': Modify an e-mail on an account (@email GM command) (account: %d (%s), new e-mail: %s, ip: %s).\n"_fmt,
+                                        server[id].name, acc,
+                                        ad.userid, new_email, ip);
                             }
+                            else
+                                LOGIN_LOG("Char-server '%s': Attempt to modify an e-mail on an account (@email GM command), but actual e-mail is incorrect (account: %d (%s), actual e-mail: %s, proposed e-mail: %s, ip: %s).\n"_fmt,
+                                        server[id].name, acc,
+                                        ad.userid,
+                                        ad.email, actual_email, ip);
+                            goto x2722_out;
                         }
                         LOGIN_LOG("Char-server '%s': Attempt to modify an e-mail on an account (@email GM command), but account doesn't exist (account: %d, ip: %s).\n"_fmt,
                                 server[id].name, acc, ip);
@@ -1130,41 +1468,40 @@ void parse_fromchar(Session *s)
                 {
                     AccountId acc = fixed.account_id;
                     int statut = fixed.status;
-                    for (AuthData& ad : auth_data)
+                    if (AuthData *adp = edit_account_id(acc))
                     {
-                        if (ad.account_id == acc)
+                        AuthData& ad = *adp;
+                        if (ad.state != statut)
                         {
-                            if (ad.state != statut)
+                            LOGIN_LOG("Char-server '%s': Status change (account: %d, new status %d, ip: %s).\n"_fmt,
+                                    server[id].name, acc, statut,
+                                    ip);
+                            if (statut != 0)
                             {
-                                LOGIN_LOG("Char-server '%s': Status change (account: %d, new status %d, ip: %s).\n"_fmt,
-                                        server[id].name, acc, statut,
-                                        ip);
-                                if (statut != 0)
-                                {
-                                    Packet_Fixed<0x2731> fixed_31;
-                                    fixed_31.account_id = acc;
-                                    fixed_31.ban_not_status = 0;
-                                    fixed_31.status_or_ban_until = static_cast<time_t>(statut);
+                                Packet_Fixed<0x2731> fixed_31;
+                                fixed_31.account_id = acc;
+                                fixed_31.ban_not_status = 0;
+                                fixed_31.status_or_ban_until = static_cast<time_t>(statut);
 
-                                    for (Session *ss : iter_char_sessions())
-                                    {
-                                        send_fpacket<0x2731, 11>(ss, fixed_31);
-                                    }
+                                for (Session *ss : iter_char_sessions())
+                                {
+                                    send_fpacket<0x2731, 11>(ss, fixed_31);
+                                }
 
-                                    for (int j = 0; j < AUTH_FIFO_SIZE; j++)
-                                    {
-                                        if (auth_fifo[j].account_id == acc)
-                                            auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
-                                    }
+                                for (int j = 0; j < AUTH_FIFO_SIZE; j++)
+                                {
+                                    if (auth_fifo[j].account_id == acc)
+                                        auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
                                 }
-                                ad.state = statut;
                             }
-                            else
-                                LOGIN_LOG("Char-server '%s':  Error of Status change - actual status is already the good status (account: %d, status %d, ip: %s).\n"_fmt,
-                                        server[id].name, acc, statut,
-                                        ip);
-                            goto x2724_out;
+                            ad.state = statut;
+                            auth_dirty.insert(ad.account_id);
                         }
+                        else
+                            LOGIN_LOG("Char-server '%s':  Error of Status change - actual status is already the good status (account: %d, status %d, ip: %s).\n"_fmt,
+                                    server[id].name, acc, statut,
+                                    ip);
+                        goto x2724_out;
                     }
                     LOGIN_LOG("Char-server '%s': Error of Status change (account: %d not found, suggested status %d, ip: %s).\n"_fmt,
                             server[id].name, acc, statut, ip);
@@ -1183,79 +1520,78 @@ void parse_fromchar(Session *s)
 
                 {
                     AccountId acc = fixed.account_id;
-                    for (AuthData& ad : auth_data)
+                    if (AuthData *adp = edit_account_id(acc))
                     {
-                        if (ad.account_id == acc)
+                        AuthData& ad = *adp;
+                        TimeT now = TimeT::now();
+                        TimeT timestamp;
+                        if (!ad.ban_until_time
+                            || ad.ban_until_time < now)
+                            timestamp = now;
+                        else
+                            timestamp = ad.ban_until_time;
+                        struct tm tmtime = timestamp;
+                        HumanTimeDiff ban_diff = fixed.ban_add;
+                        tmtime.tm_year += ban_diff.year;
+                        tmtime.tm_mon += ban_diff.month;
+                        tmtime.tm_mday += ban_diff.day;
+                        tmtime.tm_hour += ban_diff.hour;
+                        tmtime.tm_min += ban_diff.minute;
+                        tmtime.tm_sec += ban_diff.second;
+                        timestamp = tmtime;
+                        if (timestamp.okay())
                         {
-                            TimeT now = TimeT::now();
-                            TimeT timestamp;
-                            if (!ad.ban_until_time
-                                || ad.ban_until_time < now)
-                                timestamp = now;
-                            else
-                                timestamp = ad.ban_until_time;
-                            struct tm tmtime = timestamp;
-                            HumanTimeDiff ban_diff = fixed.ban_add;
-                            tmtime.tm_year += ban_diff.year;
-                            tmtime.tm_mon += ban_diff.month;
-                            tmtime.tm_mday += ban_diff.day;
-                            tmtime.tm_hour += ban_diff.hour;
-                            tmtime.tm_min += ban_diff.minute;
-                            tmtime.tm_sec += ban_diff.second;
-                            timestamp = tmtime;
-                            if (timestamp.okay())
+                            if (timestamp <= now)
+                                timestamp = TimeT();
+                            if (ad.ban_until_time != timestamp)
                             {
-                                if (timestamp <= now)
-                                    timestamp = TimeT();
-                                if (ad.ban_until_time != timestamp)
+                                if (timestamp)
                                 {
+                                    timestamp_seconds_buffer tmpstr;
                                     if (timestamp)
-                                    {
-                                        timestamp_seconds_buffer tmpstr;
-                                        if (timestamp)
-                                            stamp_time(tmpstr, &timestamp);
-                                        LOGIN_LOG("Char-server '%s': Ban request (account: %d, new final date of banishment: %lld (%s), ip: %s).\n"_fmt,
-                                                server[id].name, acc,
-                                                timestamp,
-                                                tmpstr,
-                                                ip);
-                                        Packet_Fixed<0x2731> fixed_31;
-                                        fixed_31.account_id = ad.account_id;
-                                        fixed_31.ban_not_status = 1;
-                                        fixed_31.status_or_ban_until = timestamp;
-
-                                        for (Session *ss : iter_char_sessions())
-                                        {
-                                            send_fpacket<0x2731, 11>(ss, fixed_31);
-                                        }
+                                        stamp_time(tmpstr, &timestamp);
+                                    LOGIN_LOG("Char-server '%s': Ban request (account: %d, new final date of banishment: %lld (%s), ip: %s).\n"_fmt,
+                                            server[id].name, acc,
+                                            timestamp,
+                                            tmpstr,
+                                            ip);
+                                    Packet_Fixed<0x2731> fixed_31;
+                                    fixed_31.account_id = ad.account_id;
+                                    fixed_31.ban_not_status = 1;
+                                    fixed_31.status_or_ban_until = timestamp;
 
-                                        for (int j = 0; j < AUTH_FIFO_SIZE; j++)
-                                        {
-                                            if (auth_fifo[j].account_id == acc)
-                                                auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
-                                        }
+                                    for (Session *ss : iter_char_sessions())
+                                    {
+                                        send_fpacket<0x2731, 11>(ss, fixed_31);
                                     }
-                                    else
+
+                                    for (int j = 0; j < AUTH_FIFO_SIZE; j++)
                                     {
-                                        LOGIN_LOG("Char-server '%s': Error of ban request (account: %d, new date unbans the account, ip: %s).\n"_fmt,
-                                                server[id].name, acc,
-                                                ip);
+                                        if (auth_fifo[j].account_id == acc)
+                                            auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
                                     }
-                                    ad.ban_until_time = timestamp;
                                 }
                                 else
                                 {
-                                    LOGIN_LOG("Char-server '%s': Error of ban request (account: %d, no change for ban date, ip: %s).\n"_fmt,
-                                            server[id].name, acc, ip);
+                                    LOGIN_LOG("Char-server '%s': Error of ban request (account: %d, new date unbans the account, ip: %s).\n"_fmt,
+                                            server[id].name, acc,
+                                            ip);
                                 }
+                                ad.ban_until_time = timestamp;
+                                auth_dirty.insert(ad.account_id);
                             }
                             else
                             {
-                                LOGIN_LOG("Char-server '%s': Error of ban request (account: %d, invalid date, ip: %s).\n"_fmt,
+                                LOGIN_LOG("Char-server '%s': Error of ban request (account: %d, no change for ban date, ip: %s).\n"_fmt,
                                         server[id].name, acc, ip);
                             }
-                            goto x2725_out;
                         }
+                        else
+                        {
+                            LOGIN_LOG("Char-server '%s': Error of ban request (account: %d, invalid date, ip: %s).\n"_fmt,
+                                    server[id].name, acc, ip);
+                        }
+                        goto x2725_out;
                     }
                     LOGIN_LOG("Char-server '%s': Error of ban request (account: %d not found, ip: %s).\n"_fmt,
                             server[id].name, acc, ip);
@@ -1274,38 +1610,37 @@ void parse_fromchar(Session *s)
 
                 {
                     AccountId acc = fixed.account_id;
-                    for (AuthData& ad : auth_data)
+                    if (AuthData *adp = edit_account_id(acc))
                     {
-                        if (ad.account_id == acc)
+                        AuthData& ad = *adp;
                         {
+                            SEX sex;
+                            if (ad.sex == SEX::FEMALE)
+                                sex = SEX::MALE;
+                            else
+                                sex = SEX::FEMALE;
+                            LOGIN_LOG("Char-server '%s': Sex change (account: %d, new sex %c, ip: %s).\n"_fmt,
+                                    server[id].name, acc,
+                                    sex_to_char(sex),
+                                    ip);
+                            for (int j = 0; j < AUTH_FIFO_SIZE; j++)
                             {
-                                SEX sex;
-                                if (ad.sex == SEX::FEMALE)
-                                    sex = SEX::MALE;
-                                else
-                                    sex = SEX::FEMALE;
-                                LOGIN_LOG("Char-server '%s': Sex change (account: %d, new sex %c, ip: %s).\n"_fmt,
-                                        server[id].name, acc,
-                                        sex_to_char(sex),
-                                        ip);
-                                for (int j = 0; j < AUTH_FIFO_SIZE; j++)
-                                {
-                                    if (auth_fifo[j].account_id == acc)
-                                        auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
-                                }
-                                ad.sex = sex;
+                                if (auth_fifo[j].account_id == acc)
+                                    auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
+                            }
+                            ad.sex = sex;
+                            auth_dirty.insert(ad.account_id);
 
-                                Packet_Fixed<0x2723> fixed_23;
-                                fixed_23.account_id = acc;
-                                fixed_23.sex = sex;
+                            Packet_Fixed<0x2723> fixed_23;
+                            fixed_23.account_id = acc;
+                            fixed_23.sex = sex;
 
-                                for (Session *ss : iter_char_sessions())
-                                {
-                                    send_fpacket<0x2723, 7>(ss, fixed_23);
-                                }
+                            for (Session *ss : iter_char_sessions())
+                            {
+                                send_fpacket<0x2723, 7>(ss, fixed_23);
                             }
-                            goto x2727_out;
                         }
+                        goto x2727_out;
                     }
                     LOGIN_LOG("Char-server '%s': Error of sex change (account: %d not found, sex would be reversed, ip: %s).\n"_fmt,
                             server[id].name, acc, ip);
@@ -1325,39 +1660,38 @@ void parse_fromchar(Session *s)
 
                 {
                     AccountId acc = head.account_id;
-                    for (AuthData& ad : auth_data)
+                    if (AuthData *adp = edit_account_id(acc))
                     {
-                        if (ad.account_id == acc)
-                        {
-                            LOGIN_LOG("Char-server '%s': receiving (from the char-server) of account_reg2 (account: %d, ip: %s).\n"_fmt,
-                                    server[id].name, acc, ip);
-
-                            const size_t count = std::min(ACCOUNT_REG2_NUM, repeat.size());
-                            for (size_t j = 0; j < count; ++j)
-                            {
-                                ad.account_reg2[j].str = repeat[j].name;
-                                ad.account_reg2[j].value = repeat[j].value;
-                            }
-                            ad.account_reg2_num = count;
+                        AuthData& ad = *adp;
+                        LOGIN_LOG("Char-server '%s': receiving (from the char-server) of account_reg2 (account: %d, ip: %s).\n"_fmt,
+                                server[id].name, acc, ip);
 
-                            // Sending information towards the other char-servers.
-                            Packet_Head<0x2729> head_29;
-                            std::vector<Packet_Repeat<0x2729>> repeat_29(repeat.size());
-                            head_29.account_id = head.account_id;
-                            for (size_t j = 0; j < count; ++j)
-                            {
-                                repeat_29[j].name = repeat[j].name;
-                                repeat_29[j].value = repeat[j].value;
-                            }
+                        const size_t count = std::min(ACCOUNT_REG2_NUM, repeat.size());
+                        for (size_t j = 0; j < count; ++j)
+                        {
+                            ad.account_reg2[j].str = repeat[j].name;
+                            ad.account_reg2[j].value = repeat[j].value;
+                        }
+                        ad.account_reg2_num = count;
+                        auth_dirty.insert(ad.account_id);
+
+                        // Sending information towards the other char-servers.
+                        Packet_Head<0x2729> head_29;
+                        std::vector<Packet_Repeat<0x2729>> repeat_29(repeat.size());
+                        head_29.account_id = head.account_id;
+                        for (size_t j = 0; j < count; ++j)
+                        {
+                            repeat_29[j].name = repeat[j].name;
+                            repeat_29[j].value = repeat[j].value;
+                        }
 
-                            for (Session *ss : iter_char_sessions())
-                            {
-                                if (ss == s)
-                                    continue;
-                                send_vpacket<0x2729, 8, 36>(ss, head_29, repeat_29);
-                            }
-                            goto x2728_out;
+                        for (Session *ss : iter_char_sessions())
+                        {
+                            if (ss == s)
+                                continue;
+                            send_vpacket<0x2729, 8, 36>(ss, head_29, repeat_29);
                         }
+                        goto x2728_out;
                     }
                     LOGIN_LOG("Char-server '%s': receiving (from the char-server) of account_reg2 (account: %d not found, ip: %s).\n"_fmt,
                             server[id].name, acc, ip);
@@ -1375,23 +1709,22 @@ void parse_fromchar(Session *s)
 
                 {
                     AccountId acc = fixed.account_id;
-                    for (AuthData& ad : auth_data)
+                    if (AuthData *adp = edit_account_id(acc))
                     {
-                        if (ad.account_id == acc)
+                        AuthData& ad = *adp;
+                        if (ad.ban_until_time)
                         {
-                            if (ad.ban_until_time)
-                            {
-                                ad.ban_until_time = TimeT();
-                                LOGIN_LOG("Char-server '%s': UnBan request (account: %d, ip: %s).\n"_fmt,
-                                        server[id].name, acc, ip);
-                            }
-                            else
-                            {
-                                LOGIN_LOG("Char-server '%s': Error of UnBan request (account: %d, no change for unban date, ip: %s).\n"_fmt,
-                                        server[id].name, acc, ip);
-                            }
-                            goto x272a_out;
+                            ad.ban_until_time = TimeT();
+                            auth_dirty.insert(ad.account_id);
+                            LOGIN_LOG("Char-server '%s': UnBan request (account: %d, ip: %s).\n"_fmt,
+                                    server[id].name, acc, ip);
                         }
+                        else
+                        {
+                            LOGIN_LOG("Char-server '%s': Error of UnBan request (account: %d, no change for unban date, ip: %s).\n"_fmt,
+                                    server[id].name, acc, ip);
+                        }
+                        goto x272a_out;
                     }
                     LOGIN_LOG("Char-server '%s': Error of UnBan request (account: %d not found, ip: %s).\n"_fmt,
                             server[id].name, acc, ip);
@@ -1416,32 +1749,31 @@ void parse_fromchar(Session *s)
 
                     int status = 0;
 
-                    for (AuthData& ad : auth_data)
+                    if (AuthData *adp = edit_account_id(acc))
                     {
-                        if (ad.account_id == acc)
+                        AuthData& ad = *adp;
+                        if (pass_ok(actual_pass, ad.pass))
                         {
-                            if (pass_ok(actual_pass, ad.pass))
-                            {
-                                if (new_pass.size() < 4)
-                                    status = 3;
-                                else
-                                {
-                                    status = 1;
-                                    ad.pass = MD5_saltcrypt(new_pass, make_salt());
-                                    LOGIN_LOG("Char-server '%s': Change pass success (account: %d (%s), ip: %s.\n"_fmt,
-                                            server[id].name, acc,
-                                            ad.userid, ip);
-                                }
-                            }
+                            if (new_pass.size() < 4)
+                                status = 3;
                             else
                             {
-                                status = 2;
-                                LOGIN_LOG("Char-server '%s': Attempt to modify a pass failed, wrong password. (account: %d (%s), ip: %s).\n"_fmt,
+                                status = 1;
+                                ad.pass = MD5_saltcrypt(new_pass, make_salt());
+                                auth_dirty.insert(ad.account_id);
+                                LOGIN_LOG("Char-server '%s': Change pass success (account: %d (%s), ip: %s.\n"_fmt,
                                         server[id].name, acc,
                                         ad.userid, ip);
                             }
-                            goto x2740_out;
                         }
+                        else
+                        {
+                            status = 2;
+                            LOGIN_LOG("Char-server '%s': Attempt to modify a pass failed, wrong password. (account: %d (%s), ip: %s).\n"_fmt,
+                                    server[id].name, acc,
+                                    ad.userid, ip);
+                        }
+                        goto x2740_out;
                     }
                 x2740_out:
                     Packet_Fixed<0x2741> fixed_41;
@@ -1545,8 +1877,9 @@ void parse_admin(Session *s)
                     // Sending accounts information
                     std::vector<Packet_Repeat<0x7921>> repeat_21;
 
-                    for (const AuthData& ad : auth_data)
+                    for (const std::shared_ptr<AuthData>& adp : auth_data)
                     {
+                        const AuthData& ad = *adp;
                         AccountId account_id = ad.account_id;
                         if (!(account_id < st) && !(ed < account_id))
                         {
@@ -1603,21 +1936,19 @@ void parse_admin(Session *s)
                     }
                     else
                     {
-                        for (const AuthData& ad : auth_data)
+                        if (const AuthData *adp = search_account(ma.userid))
                         {
-                            if (ad.userid == ma.userid)
-                            {
-                                LOGIN_LOG("'ladmin': Attempt to create an already existing account (account: %s ip: %s)\n"_fmt,
-                                        ad.userid, ip);
-                                goto x7930_out;
-                            }
+                            const AuthData& ad = *adp;
+                            LOGIN_LOG("'ladmin': Attempt to create an already existing account (account: %s ip: %s)\n"_fmt,
+                                    ad.userid, ip);
+                            goto x7930_out;
                         }
                         {
                             AccountEmail email = fixed.email;
                             AccountId new_id = mmo_auth_new(&ma, ma.sex, email);
                             LOGIN_LOG("'ladmin': Account creation (account: %s (id: %d), sex: %c, email: %s, ip: %s)\n"_fmt,
                                     ma.userid, new_id,
-                                    sex_to_char(ma.sex), auth_data.back().email, ip);
+                                    sex_to_char(ma.sex), auth_data.back()->email, ip);
                             fixed_31.account_id = new_id;
                         }
                     }
@@ -1637,7 +1968,7 @@ void parse_admin(Session *s)
                 Packet_Fixed<0x7933> fixed_33;
                 fixed_33.account_id = AccountId();
                 AccountName account_name = stringish<AccountName>(fixed.account_name.to_print());
-                AuthData *ad = search_account(account_name);
+                AuthData *ad = edit_account(account_name);
                 if (ad)
                 {
                     // Char-server is notified of deletion (for characters deletion).
@@ -1661,8 +1992,7 @@ void parse_admin(Session *s)
                         LOGIN_LOG("%s\n"_fmt, buf2);
                     }
                     // delete account
-                    ad->userid = AccountName();
-                    ad->account_id = AccountId();
+                    auth_delete(ad);
                 }
                 else
                 {
@@ -1684,12 +2014,13 @@ void parse_admin(Session *s)
                 Packet_Fixed<0x7935> fixed_35;
                 fixed_35.account_id = AccountId();
                 AccountName account_name = stringish<AccountName>(fixed.account_name.to_print());
-                AuthData *ad = search_account(account_name);
+                AuthData *ad = edit_account(account_name);
                 if (ad)
                 {
                     fixed_35.account_name = ad->userid;
                     AccountPass plain = stringish<AccountPass>(fixed.password);
                     ad->pass = MD5_saltcrypt(plain, make_salt());
+                    auth_dirty.insert(ad->account_id);
                     fixed_35.account_id = ad->account_id;
                     LOGIN_LOG("'ladmin': Modification of a password (account: %s, new password: %s, ip: %s)\n"_fmt,
                             ad->userid, ad->pass, ip);
@@ -1722,7 +2053,7 @@ void parse_admin(Session *s)
                         // 7: // 6 = Your are Prohibited to log in until %s
                         error_message = stringish<timestamp_seconds_buffer>("-"_s);
                     }
-                    AuthData *ad = search_account(account_name);
+                    AuthData *ad = edit_account(account_name);
                     if (ad)
                     {
                         fixed_37.account_name = ad->userid;
@@ -1759,6 +2090,7 @@ void parse_admin(Session *s)
                             }
                             ad->state = statut;
                             ad->error_message = error_message;
+                            auth_dirty.insert(ad->account_id);
                         }
                     }
                     else
@@ -1859,7 +2191,7 @@ void parse_admin(Session *s)
                     }
                     else
                     {
-                        AuthData *ad = search_account(account_name);
+                        AuthData *ad = edit_account(account_name);
                         if (ad)
                         {
                             fixed_3d.account_name = ad->userid;
@@ -1873,6 +2205,7 @@ void parse_admin(Session *s)
                                         auth_fifo[j].login_id1++;   // to avoid reconnection error when come back from map-server (char-server will ask again the authentification)
                                 }
                                 ad->sex = sex;
+                                auth_dirty.insert(ad->account_id);
                                 LOGIN_LOG("'ladmin': Modification of a sex (account: %s, new sex: %c, ip: %s)\n"_fmt,
                                         ad->userid, sex_to_char(sex), ip);
 
@@ -2045,11 +2378,12 @@ void parse_admin(Session *s)
                     }
                     else
                     {
-                        AuthData *ad = search_account(account_name);
+                        AuthData *ad = edit_account(account_name);
                         if (ad)
                         {
                             fixed_41.account_name = ad->userid;
                             ad->email = email;
+                            auth_dirty.insert(ad->account_id);
                             fixed_41.account_id = ad->account_id;
                             LOGIN_LOG("'ladmin': Modification of an email (account: %s, new e-mail: %s, ip: %s)\n"_fmt,
                                     ad->userid, email, ip);
@@ -2076,7 +2410,7 @@ void parse_admin(Session *s)
                 Packet_Fixed<0x7943> fixed_43;
                 fixed_43.account_id = AccountId();
                 AccountName account_name = stringish<AccountName>(head.account_name.to_print());
-                AuthData *ad = search_account(account_name);
+                AuthData *ad = edit_account(account_name);
                 if (ad)
                 {
                     fixed_43.account_name = ad->userid;
@@ -2091,6 +2425,7 @@ void parse_admin(Session *s)
                         ad->memo = repeat;
                     }
                     ad->memo = ad->memo.to_print();
+                    auth_dirty.insert(ad->account_id);
                     fixed_43.account_id = ad->account_id;
                     LOGIN_LOG("'ladmin': Modification of a memo field (account: %s, new memo: %s, ip: %s)\n"_fmt,
                             ad->userid, ad->memo, ip);
@@ -2145,15 +2480,13 @@ void parse_admin(Session *s)
                 Packet_Fixed<0x7947> fixed_47;
                 fixed_47.account_id = account_id;
                 fixed_47.account_name = {};
-                for (const AuthData& ad : auth_data)
+                if (const AuthData *adp = search_account_id(account_id))
                 {
-                    if (ad.account_id == account_id)
-                    {
-                        fixed_47.account_name = ad.userid;
-                        LOGIN_LOG("'ladmin': Request (by id) of an account name (account: %s, id: %d, ip: %s)\n"_fmt,
-                                ad.userid, account_id, ip);
-                        goto x7946_out;
-                    }
+                    const AuthData& ad = *adp;
+                    fixed_47.account_name = ad.userid;
+                    LOGIN_LOG("'ladmin': Request (by id) of an account name (account: %s, id: %d, ip: %s)\n"_fmt,
+                            ad.userid, account_id, ip);
+                    goto x7946_out;
                 }
                 LOGIN_LOG("'ladmin': Name request (by id) of an unknown account (id: %d, ip: %s)\n"_fmt,
                         account_id, ip);
@@ -2180,7 +2513,7 @@ void parse_admin(Session *s)
                     timestamp_seconds_buffer tmpstr = stringish<timestamp_seconds_buffer>("no banishment"_s);
                     if (timestamp)
                         stamp_time(tmpstr, &timestamp);
-                    AuthData *ad = search_account(account_name);
+                    AuthData *ad = edit_account(account_name);
                     if (ad)
                     {
                         fixed_4b.account_name = ad->userid;
@@ -2211,6 +2544,7 @@ void parse_admin(Session *s)
                                 }
                             }
                             ad->ban_until_time = timestamp;
+                            auth_dirty.insert(ad->account_id);
                         }
                     }
                     else
@@ -2238,7 +2572,7 @@ void parse_admin(Session *s)
                 {
                     fixed_4d.account_id = AccountId();
                     AccountName account_name = stringish<AccountName>(fixed.account_name.to_print());
-                    AuthData *ad = search_account(account_name);
+                    AuthData *ad = edit_account(account_name);
                     if (ad)
                     {
                         fixed_4d.account_id = ad->account_id;
@@ -2296,6 +2630,7 @@ void parse_admin(Session *s)
                                     }
                                 }
                                 ad->ban_until_time = timestamp;
+                                auth_dirty.insert(ad->account_id);
                             }
                         }
                         else
@@ -2427,26 +2762,24 @@ void parse_admin(Session *s)
                 Packet_Head<0x7953> head_53;
                 head_53.account_id = account_id;
                 head_53.account_name = AccountName();
-                for (const AuthData& ad : auth_data)
+                if (const AuthData *adp = search_account_id(account_id))
                 {
-                    if (ad.account_id == account_id)
-                    {
-                        LOGIN_LOG("'ladmin': Sending information of an account (request by the id; account: %s, id: %d, ip: %s)\n"_fmt,
-                                ad.userid, account_id, ip);
-                        head_53.gm_level = isGM(ad.account_id);
-                        head_53.account_name = ad.userid;
-                        head_53.sex = ad.sex;
-                        head_53.login_count = ad.logincount;
-                        head_53.state = ad.state;
-                        head_53.error_message = ad.error_message;
-                        head_53.last_login_string = ad.lastlogin;
-                        head_53.ip_string = convert_for_printf(ad.last_ip);
-                        head_53.email = ad.email;
-                        head_53.ban_until = ad.ban_until_time;
-                        XString repeat_53 = ad.memo;
-                        send_vpacket<0x7953, 150, 1>(s, head_53, repeat_53);
-                        goto x7954_out;
-                    }
+                    const AuthData& ad = *adp;
+                    LOGIN_LOG("'ladmin': Sending information of an account (request by the id; account: %s, id: %d, ip: %s)\n"_fmt,
+                            ad.userid, account_id, ip);
+                    head_53.gm_level = isGM(ad.account_id);
+                    head_53.account_name = ad.userid;
+                    head_53.sex = ad.sex;
+                    head_53.login_count = ad.logincount;
+                    head_53.state = ad.state;
+                    head_53.error_message = ad.error_message;
+                    head_53.last_login_string = ad.lastlogin;
+                    head_53.ip_string = convert_for_printf(ad.last_ip);
+                    head_53.email = ad.email;
+                    head_53.ban_until = ad.ban_until_time;
+                    XString repeat_53 = ad.memo;
+                    send_vpacket<0x7953, 150, 1>(s, head_53, repeat_53);
+                    goto x7954_out;
                 }
                 {
                     LOGIN_LOG("'ladmin': Attempt to obtain information (by the id) of an unknown account (id: %d, ip: %s)\n"_fmt,
@@ -3204,9 +3537,14 @@ bool login_confs(io::Spanned<XString> key, io::Spanned<ZString> value)
 //--------------------------------------
 void term_func(void)
 {
-    login::mmo_auth_sync();
+    // the last periodic save must be on disk before this one replaces it
+    login::save_thread.wait();
+    uint64_t bytes = 0;
+    login::mmo_auth_sync(login::auth_data, login::account_id_count, &bytes);
 
     login::auth_data.clear();
+    login::auth_index_by_name.clear();
+    login::auth_index_by_id.clear();
     login::gm_account_db.clear();
     for (int i = 0; i < login::MAX_SERVERS; i++)
     {
@@ -3226,6 +3564,7 @@ int do_init(Slice<ZString> argv)
 {
     ZString argv0 = argv.pop_front();
     bool loaded_config_yet = false;
+    bool convert = false;
     while (argv)
     {
         ZString argvi = argv.pop_front();
@@ -3233,8 +3572,10 @@ int do_init(Slice<ZString> argv)
         {
             if (argvi == "--help"_s)
             {
-                PRINTF("Usage: %s [--help] [--version] [files...]\n"_fmt,
+                PRINTF("Usage: %s [--help] [--version] [--write-snapshot | --write-text] [files...]\n"_fmt,
                         argv0);
+                PRINTF("  --write-snapshot  load the text file, write both formats, and exit\n"_fmt);
+                PRINTF("  --write-text      load the snapshot alone, write both formats, and exit\n"_fmt);
                 exit(0);
             }
             else if (argvi == "--version"_s)
@@ -3242,6 +3583,16 @@ int do_init(Slice<ZString> argv)
                 PRINTF("%s\n"_fmt, CURRENT_VERSION_STRING);
                 exit(0);
             }
+            else if (argvi == "--write-snapshot"_s)
+            {
+                login::snapshot_load = SnapshotLoad::TEXT;
+                convert = true;
+            }
+            else if (argvi == "--write-text"_s)
+            {
+                login::snapshot_load = SnapshotLoad::SNAPSHOT;
+                convert = true;
+            }
             else
             {
                 FPRINTF(stderr, "Unknown argument: %s\n"_fmt, argvi);
@@ -3274,6 +3625,22 @@ int do_init(Slice<ZString> argv)
     login::read_gm_account();
     login::mmo_auth_init();
 //     set_termfunc (mmo_auth_sync);
+
+    if (convert)
+    {
+        if (!runflag)
+            return 0;
+        if (login::snapshot_missing)
+        {
+            // writing what little was loaded would wipe out the rest
+            PRINTF("The snapshot couldn't be loaded, so nothing was written.\n"_fmt);
+            exit(1);
+        }
+        uint64_t bytes = 0;
+        login::mmo_auth_sync(login::auth_data, login::account_id_count, &bytes);
+        exit(0);
+    }
+
     login::login_session = make_listen_port(login::login_conf.login_port, SessionParsers{.func_parse= login::parse_login, .func_delete= login::delete_login});
 
 
@@ -22,6 +22,8 @@
 
 #include "fwd.hpp"
 
+#include "../ints/little.hpp"
+
 #include "../strings/vstring.hpp"
 
 #include "../compat/time_t.hpp"
@@ -36,6 +38,9 @@
 #include "../mmo/ids.hpp"
 #include "../mmo/strs.hpp"
 
+#include "../proto-base/net-array.hpp"
+#include "../proto-base/net-string.hpp"
+
 #include "../proto2/net-GlobalReg.hpp"
 
 #include "../high/mmo.hpp"
@@ -66,6 +71,33 @@ struct AuthData
     Array<GlobalReg, ACCOUNT_REG2_NUM> account_reg2;
 };
 
+} // namespace login
+
+/// An account as stored in account_bin.
+struct NetAuthData
+{
+    Little32 account_id;
+    Byte sex;
+    NetString<24> userid;
+    NetString<40> pass;
+    NetString<24> lastlogin;
+    Little32 logincount;
+    Little32 state;
+    NetString<40> email;
+    NetString<20> error_message;
+    Little64 ban_until_time;
+    IP4Address last_ip;
+    NetString<255> memo;
+    Little32 account_reg2_num;
+    NetArray<NetGlobalReg, ACCOUNT_REG2_NUM> account_reg2;
+};
+static_assert(alignof(NetAuthData) == 1, "alignof(NetAuthData) == 1");
+
+bool native_to_network(NetAuthData *network, const login::AuthData& native);
+bool network_to_native(login::AuthData *native, const NetAuthData& network);
+
+namespace login
+{
 struct mmo_char_server
 {
     ServerName name;
@@ -0,0 +1,60 @@
+#include "login.hpp"
+//    login_test.cpp - Testsuite for the login server's account records
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include "../strings/literal.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+TEST(login, snapshotfullreg)
+{
+    login::AuthData ad {};
+    ad.account_id = wrap<AccountId>(2000000);
+    ad.userid = stringish<AccountName>("someone"_s);
+    ad.account_reg2_num = ACCOUNT_REG2_NUM;
+    for (int i = 0; i < ad.account_reg2_num; ++i)
+    {
+        ad.account_reg2[i].str = stringish<VarName>("reg"_s);
+        ad.account_reg2[i].value = i;
+    }
+
+    NetAuthData net;
+    ASSERT_TRUE(native_to_network(&net, ad));
+    login::AuthData back {};
+    ASSERT_TRUE(network_to_native(&back, net));
+    EXPECT_EQ(back.account_id, ad.account_id);
+    EXPECT_EQ(back.userid, ad.userid);
+    ASSERT_EQ(back.account_reg2_num, static_cast<int>(ACCOUNT_REG2_NUM));
+    for (int i = 0; i < back.account_reg2_num; ++i)
+    {
+        EXPECT_EQ(back.account_reg2[i].str, ad.account_reg2[i].str);
+        EXPECT_EQ(back.account_reg2[i].value, ad.account_reg2[i].value);
+    }
+
+    // one more than an account can hold is a broken record
+    ad.account_reg2_num = ACCOUNT_REG2_NUM + 1;
+    ASSERT_TRUE(native_to_network(&net, ad));
+    EXPECT_FALSE(network_to_native(&back, net));
+}
+} // namespace tmwa
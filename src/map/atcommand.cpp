@@ -34,6 +34,7 @@
 #include "../strings/vstring.hpp"
 
 #include "../generic/db.hpp"
+#include "../generic/object-pool.hpp"
 #include "../generic/random.hpp"
 
 #include "../io/cxxstdio.hpp"
@@ -66,6 +67,7 @@
 #include "globals.hpp"
 #include "intif.hpp"
 #include "itemdb.hpp"
+#include "magic-interpreter.hpp"
 #include "map.hpp"
 #include "map_conf.hpp"
 #include "mob.hpp"
@@ -73,6 +75,7 @@
 #include "npc-parse.hpp"
 #include "party.hpp"
 #include "pc.hpp"
+#include "script-profile.hpp"
 #include "skill.hpp"
 #include "storage.hpp"
 #include "tmw.hpp"
@@ -4925,6 +4928,69 @@ ATCE atcommand_source(Session *s, dumb_ptr<map_session_data>,
     return ATCE::OKAY;
 }
 
+template<class P>
+static
+void atcommand_pool_line(Session *s, ZString name, const P& pool)
+{
+    AString output = STRPRINTF("%s: %zu live, %zu peak, %zu slots"_fmt,
+            name, pool.live(), pool.high_water(), pool.capacity());
+    clif_displaymessage(s, output);
+}
+
+static
+ATCE atcommand_pools(Session *s, dumb_ptr<map_session_data>,
+        ZString)
+{
+    atcommand_pool_line(s, "mobs"_s, mob_data::pool());
+    atcommand_pool_line(s, "floor items"_s, flooritem_data::pool());
+    atcommand_pool_line(s, "message npcs"_s, npc_data_message::pool());
+    atcommand_pool_line(s, "spell invocations"_s, magic::invocation::pool());
+    atcommand_pool_line(s, "spell envs"_s, magic::env_t::pool());
+    atcommand_pool_line(s, "spell areas"_s, magic::area_t::pool());
+    AString output = STRPRINTF("spell env vars: %zu spare"_fmt,
+            magic::magic_spare_vars.size());
+    clif_displaymessage(s, output);
+
+    return ATCE::OKAY;
+}
+
+static
+ATCE atcommand_scriptprofile(Session *s, dumb_ptr<map_session_data>,
+        ZString message)
+{
+    XString mode;
+    int count = 10;
+
+    if (!extract(message, record<' ', 1>(&mode, &count)) || count <= 0)
+        return ATCE::USAGE;
+
+    if (mode == "on"_s)
+    {
+        script_profiling = true;
+        clif_displaymessage(s, "Script profiling enabled."_s);
+    }
+    else if (mode == "off"_s)
+    {
+        script_profiling = false;
+        clif_displaymessage(s, "Script profiling disabled."_s);
+    }
+    else if (mode == "reset"_s)
+    {
+        script_profile_reset();
+        clif_displaymessage(s, "Script profile cleared."_s);
+    }
+    else if (mode == "npc"_s || mode == "builtin"_s)
+    {
+        for (AString& line : script_profile_report(mode == "builtin"_s, count))
+            clif_displaymessage(s, line);
+        clif_displaymessage(s, "End of list"_s);
+    }
+    else
+        return ATCE::USAGE;
+
+    return ATCE::OKAY;
+}
+
 
 
 // declared extern above
@@ -5350,6 +5416,12 @@ Map<XString, AtCommandInfo> atcommand_info =
     {"source"_s, {""_s,
         0, atcommand_source,
         "Legal information about source code (must be a level 0 command!)"_s}},
+    {"pools"_s, {""_s,
+        99, atcommand_pools,
+        "Show occupancy of the mob, floor item, and message npc pools"_s}},
+    {"scriptprofile"_s, {"<on|off|reset|npc|builtin> [count]"_s,
+        99, atcommand_scriptprofile,
+        "Collect and show where script execution time goes"_s}},
 };
 } // namespace map
 } // namespace tmwa
@@ -678,6 +678,7 @@ int chrif_accountreg2(Session *, const Packet_Head<0x2b11>& head, const std::vec
         sd->status.account_reg2[j].value = repeat[j].value;
     }
     sd->status.account_reg2_num = jlim;
+    pc_reindexreg(sd);
 
     return 0;
 }
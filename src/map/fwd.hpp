@@ -66,9 +66,19 @@ class npc_data_message;
 
 struct item_data;
 
+class WalkStep;
+struct walk_entry;
+
 struct ScriptState;
+struct ScriptSlice;
+struct script_cache_entry;
+struct script_profile;
+struct builtin_profile;
 struct str_data_t;
 class SIR;
+template<class V>
+class SIRMap;
+enum class VariableScope : uint8_t;
 
 namespace magic
 {
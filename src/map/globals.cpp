@@ -30,8 +30,12 @@
 #include "map_conf.hpp"
 #include "mob.hpp"
 #include "npc-internal.hpp"
+#include "script-cache.hpp"
+#include "script-call-internal.hpp"
 #include "script-parse-internal.hpp"
+#include "script-profile.hpp"
 #include "skill.hpp"
+#include "walk.hpp"
 
 #include "../poison.hpp"
 
@@ -53,7 +57,9 @@ namespace tmwa
         {
             // Global magic conf
             magic_conf_t magic_conf;
-            env_t magic_default_env = { &magic_conf, nullptr };
+            env_t magic_default_env(&magic_conf);
+            // variable arrays of freed envs, kept for the next alloc_env()
+            std::vector<std::unique_ptr<val_t[]>> magic_spare_vars;
             namespace magic_v2
             {
                 std::map<RString, proc_t> procs;
@@ -78,10 +84,16 @@ namespace tmwa
         std::unique_ptr<io::AppendFile> map_logfile;
         long map_logfile_index;
         mob_db_ mob_db[2001];
+        uint32_t mob_ai_pass;
+        std::vector<dumb_ptr<block_list>> mob_ai_list;
         std::list<AString> npc_srcs;
         int npc_warp, npc_shop, npc_script, npc_mob;
+        int npc_mob_areas, npc_mob_areas_blocked, npc_mob_areas_full;
         BlockId npc_id = START_NPC_NUM;
         Map<NpcEvent, struct event_data> ev_db;
+        // secondary indices of ev_db, each kept in ev_db order
+        Map<ScriptLabel, std::vector<NpcEvent>> ev_db_by_label;
+        Map<NpcName, std::vector<ScriptLabel>> ev_db_by_npc;
         DMap<NpcName, dumb_ptr<npc_data>> npcs_by_name;
         // used for clock-based event triggers
         // only tm_min, tm_hour, and tm_mday are used
@@ -113,14 +125,31 @@ namespace tmwa
         int parse_cmd_if = 0;
         Option<Borrowed<str_data_t>> parse_cmdp = None;
         InternPool variable_names;
+        // parallel to variable_names
+        std::vector<VariableScope> variable_scopes;
         // TODO: replace this whole mess with some sort of input stream that works
         // a line at a time.
         ZString startptr;
         int startline;
         int script_errors = 0;
-        DMap<SIR, int> mapreg_db;
-        Map<SIR, RString> mapregstr_db;
+        // what the parser's peephole passes managed to do
+        int script_folded, script_threaded;
+        size_t script_folded_bytes;
+        bool script_profiling = false;
+        Map<RString, script_profile> script_profile_db;
+        std::vector<builtin_profile> builtin_profile_db;
+        std::vector<ScriptSlice> script_run_queue;
+        Timer script_run_timer;
+        Map<uint64_t, script_cache_entry> script_cache_db;
+        uint64_t script_cache_salt;
+        bool script_cache_ready;
+        int script_cache_hits, script_cache_misses;
+        SIRMap<int> mapreg_db;
+        SIRMap<RString> mapregstr_db;
         int mapreg_dirty = -1;
+        // changed since mapreg_txt was last written or appended to
+        std::set<SIR> mapreg_dirty_keys;
+        size_t mapreg_saved_lines, mapreg_journal_lines;
 
         std::vector<SkillID> skill_pool_skills;
         earray<skill_db_, SkillID, SkillID::MAX_SKILL_DB> skill_db;
@@ -130,6 +159,13 @@ namespace tmwa
         BlockId skill_area_temp_id;
         int skill_area_temp_hp;
 
+        // min-heap of pending half-steps, and the one Timer for all of them
+        std::vector<walk_entry> walk_queue;
+        std::vector<walk_entry> walk_batch;
+        Timer walk_timer;
+        tick_t walk_timer_tick;
+        uint32_t walk_serial;
+
         // Some other globals are not moved here, because they are
         // large and initialized in-place and then *mostly* unmodified.
         //
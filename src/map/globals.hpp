@@ -53,6 +53,7 @@ namespace tmwa
             // Global magic conf
             extern magic_conf_t magic_conf;
             extern env_t magic_default_env;
+            extern std::vector<std::unique_ptr<val_t[]>> magic_spare_vars;
             namespace magic_v2
             {
                 extern std::map<RString, proc_t> procs;
@@ -73,10 +74,15 @@ namespace tmwa
         extern std::unique_ptr<io::AppendFile> map_logfile;
         extern long map_logfile_index;
         extern mob_db_ mob_db[2001];
+        extern uint32_t mob_ai_pass;
+        extern std::vector<dumb_ptr<block_list>> mob_ai_list;
         extern std::list<AString> npc_srcs;
         extern int npc_warp, npc_shop, npc_script, npc_mob;
+        extern int npc_mob_areas, npc_mob_areas_blocked, npc_mob_areas_full;
         extern BlockId npc_id;
         extern Map<NpcEvent, event_data> ev_db;
+        extern Map<ScriptLabel, std::vector<NpcEvent>> ev_db_by_label;
+        extern Map<NpcName, std::vector<ScriptLabel>> ev_db_by_npc;
         extern DMap<NpcName, dumb_ptr<npc_data>> npcs_by_name;
         extern tm ev_tm_b;
         extern Map<PartyId, PartyMost> party_db;
@@ -94,15 +100,34 @@ namespace tmwa
         extern int parse_cmd_if;
         extern Option<Borrowed<str_data_t>> parse_cmdp;
         extern InternPool variable_names;
+        extern std::vector<VariableScope> variable_scopes;
         extern ZString startptr;
         extern int startline;
         extern int script_errors;
-        extern DMap<SIR, int> mapreg_db;
-        extern Map<SIR, RString> mapregstr_db;
+        extern int script_folded, script_threaded;
+        extern size_t script_folded_bytes;
+        extern bool script_profiling;
+        extern Map<RString, script_profile> script_profile_db;
+        extern std::vector<builtin_profile> builtin_profile_db;
+        extern std::vector<ScriptSlice> script_run_queue;
+        extern Timer script_run_timer;
+        extern Map<uint64_t, script_cache_entry> script_cache_db;
+        extern uint64_t script_cache_salt;
+        extern bool script_cache_ready;
+        extern int script_cache_hits, script_cache_misses;
+        extern SIRMap<int> mapreg_db;
+        extern SIRMap<RString> mapregstr_db;
         extern int mapreg_dirty;
+        extern std::set<SIR> mapreg_dirty_keys;
+        extern size_t mapreg_saved_lines, mapreg_journal_lines;
         extern std::vector<SkillID> skill_pool_skills;
         extern earray<skill_db_, SkillID, SkillID::MAX_SKILL_DB> skill_db;
         extern BlockId skill_area_temp_id;
         extern int skill_area_temp_hp;
+        extern std::vector<walk_entry> walk_queue;
+        extern std::vector<walk_entry> walk_batch;
+        extern Timer walk_timer;
+        extern tick_t walk_timer_tick;
+        extern uint32_t walk_serial;
     } // namespace map
 } // namespace tmwa
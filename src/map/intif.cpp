@@ -382,6 +382,7 @@ int intif_parse_AccountReg(Session *, const Packet_Head<0x3804>& head, const std
         sd->status.account_reg[j].value = repeat[j].value;
     }
     sd->status.account_reg_num = jlim;
+    pc_reindexreg(sd);
 
     return 0;
 }
@@ -1676,14 +1676,127 @@ bool type_key_matches(char ty_key, val_t *arg, bool begin)
     }
 }
 
+char magic_static_type(dumb_ptr<expr_t> expr)
+{
+    MATCH_BEGIN (*expr)
+    {
+        MATCH_CASE (const val_t&, e_val)
+        {
+            MATCH_BEGIN (e_val)
+            {
+                MATCH_CASE (const ValInt&, v)
+                {
+                    (void)v;
+                    return 'i';
+                }
+                MATCH_CASE (const ValDir&, v)
+                {
+                    (void)v;
+                    return 'd';
+                }
+                MATCH_CASE (const ValString&, v)
+                {
+                    (void)v;
+                    return 's';
+                }
+                MATCH_CASE (const ValLocation&, v)
+                {
+                    (void)v;
+                    return 'l';
+                }
+                MATCH_CASE (const ValArea&, v)
+                {
+                    (void)v;
+                    return 'a';
+                }
+                MATCH_CASE (const ValSpell&, v)
+                {
+                    (void)v;
+                    return 'S';
+                }
+            }
+            MATCH_END ();
+            return 0;
+        }
+        MATCH_CASE (const e_location_t&, e_location)
+        {
+            (void)e_location;
+            return 'l';
+        }
+        MATCH_CASE (const e_area_t&, e_area)
+        {
+            (void)e_area;
+            return 'a';
+        }
+        MATCH_CASE (const ExprFunApp&, e_funapp)
+        {
+            // entities are turned back into ids on return
+            switch (char ret_ty = e_funapp.funp->ret_ty)
+            {
+                case 'i':
+                case 'd':
+                case 's':
+                case 'l':
+                case 'a':
+                case 'S':
+                    return ret_ty;
+                default:
+                    return 0;
+            }
+        }
+    }
+    MATCH_END ();
+    // variables and fields
+    return 0;
+}
+
+StaticMatch magic_static_match(char want, char have)
+{
+    if (!have)
+        return StaticMatch::DYNAMIC;
+    switch (want)
+    {
+        case 'i':
+        case 's':
+            // anything converts, but only these need not be
+            return want == have ? StaticMatch::ALWAYS : StaticMatch::DYNAMIC;
+        case 'l':
+        case 'a':
+            if (want == have)
+                return StaticMatch::ALWAYS;
+            // make_location() or make_area()
+            if (have == 'l' || have == 'a')
+                return StaticMatch::DYNAMIC;
+            return StaticMatch::NEVER;
+        case 'd':
+        case 'S':
+            return want == have ? StaticMatch::ALWAYS : StaticMatch::NEVER;
+        case 'e':
+        case 'I':
+            // never a literal or a return value
+            return StaticMatch::NEVER;
+        default:
+            return StaticMatch::ALWAYS;
+    }
+}
+
 int magic_signature_check(ZString opname, ZString funname, ZString signature,
-        Slice<val_t> args, int line, int column)
+        Slice<val_t> args, unsigned dynamic_args, int line, int column)
 {
     int i;
     for (i = 0; i < args.size(); i++)
     {
         val_t *arg = &args[i];
 
+        // magic-v2 already saw that this has the right type,
+        // if it has a value at all
+        if (!(dynamic_args & (1U << i)))
+        {
+            if (arg->is<ValFail>() && *(signature.begin() + i) != '_')
+                return 1;
+            continue;
+        }
+
         // whoa, it turns out the second p *does* shadow this one
         if (ValEntityInt *p1 = arg->get_if<ValEntityInt>())
         {
@@ -1784,7 +1897,7 @@ void magic_eval(dumb_ptr<env_t> env, val_t *dest, dumb_ptr<expr_t> expr)
             for (i = 0; i < args_nr; ++i)
                 magic_eval(env, &arguments[i], e_funapp.args[i]);
             if (magic_signature_check("function"_s, f->name, f->signature, Slice<val_t>(arguments, args_nr),
-                        e_funapp.line_nr, e_funapp.column)
+                        e_funapp.dynamic_args, e_funapp.line_nr, e_funapp.column)
                     || f->fun(env, dest, Slice<val_t>(arguments, args_nr)))
                 *dest = ValFail();
             else
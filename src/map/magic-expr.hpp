@@ -98,7 +98,27 @@ int magic_location_in_area(Borrowed<map_local> m, int x, int y, dumb_ptr<area_t>
 /* Helper definitions for dealing with functions and operations */
 
 int magic_signature_check(ZString opname, ZString funname, ZString signature,
-        Slice<val_t> args, int line, int column);
+        Slice<val_t> args, unsigned dynamic_args, int line, int column);
+
+/* Load-time type checking */
+
+enum class StaticMatch
+{
+    NEVER,
+    DYNAMIC,
+    ALWAYS,
+};
+
+/**
+ * The type key that an expression will have whenever it doesn't fail,
+ * or 0 if that is only known at runtime.
+ */
+char magic_static_type(dumb_ptr<expr_t> expr);
+/**
+ * Whether a value of static type `have' matches the type key `want'
+ * of a signature.  Only DYNAMIC ones need checking on every call.
+ */
+StaticMatch magic_static_match(char want, char have);
 
 Borrowed<map_local> magic_area_rect(int *x, int *y, int *width, int *height,
         area_t& area);
@@ -0,0 +1,97 @@
+#include "magic-expr.hpp"
+//    magic-expr_test.cpp - Testsuite for load-time magic type checks
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include "../strings/rstring.hpp"
+#include "../strings/literal.hpp"
+
+#include "../mmo/clif.t.hpp"
+
+#include "magic-interpreter.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+namespace magic
+{
+TEST(magic, staticmatch)
+{
+    // for each type key a signature may hold, the result for every
+    // static type, in the order of `haves': N(EVER), D(YNAMIC), A(LWAYS)
+    const char haves[] = {0, 'i', 'd', 's', 'l', 'a', 'S'};
+    struct
+    {
+        char want;
+        const char *expect;
+    } table[] =
+    {
+        {'i', "DADDDDD"},
+        {'s', "DDDADDD"},
+        {'l', "DNNNADN"},
+        {'a', "DNNNDAN"},
+        {'d', "DNANNNN"},
+        {'S', "DNNNNNA"},
+        // entities and invocations are never literals or return values
+        {'e', "DNNNNNN"},
+        {'I', "DNNNNNN"},
+        {'_', "DAAAAAA"},
+        {'.', "DAAAAAA"},
+    };
+    for (const auto& row : table)
+    {
+        for (size_t i = 0; i < sizeof(haves); ++i)
+        {
+            StaticMatch expect = row.expect[i] == 'N' ? StaticMatch::NEVER
+                : row.expect[i] == 'D' ? StaticMatch::DYNAMIC
+                : StaticMatch::ALWAYS;
+            EXPECT_EQ(expect, magic_static_match(row.want, haves[i]))
+                << "want '" << row.want << "' have '" << haves[i] << "'";
+        }
+    }
+}
+
+TEST(magic, statictype)
+{
+    EXPECT_EQ('i', magic_static_type(dumb_ptr<expr_t>::make(val_t(ValInt{1}))));
+    EXPECT_EQ('d', magic_static_type(dumb_ptr<expr_t>::make(val_t(ValDir{DIR::S}))));
+    EXPECT_EQ('s', magic_static_type(dumb_ptr<expr_t>::make(val_t(ValString{"x"_s}))));
+    EXPECT_EQ(0, magic_static_type(dumb_ptr<expr_t>::make(val_t(ValUndef{}))));
+    EXPECT_EQ('l', magic_static_type(dumb_ptr<expr_t>::make(e_location_t())));
+    // a variable could hold anything
+    EXPECT_EQ(0, magic_static_type(dumb_ptr<expr_t>::make(ExprId{0})));
+
+    // an entity comes back as an id, so only the function's own
+    // result type is trusted for plain values
+    fun_t f_int {"f"_s, ""_s, 'i', nullptr};
+    fun_t f_entity {"g"_s, ""_s, 'e', nullptr};
+    ExprFunApp app {};
+    app.funp = &f_int;
+    EXPECT_EQ('i', magic_static_type(dumb_ptr<expr_t>::make(app)));
+    app.funp = &f_entity;
+    EXPECT_EQ(0, magic_static_type(dumb_ptr<expr_t>::make(app)));
+}
+} // namespace magic
+} // namespace map
+} // namespace tmwa
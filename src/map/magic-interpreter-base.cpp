@@ -91,11 +91,58 @@ AString magic_find_invocation(XString spellname)
     return AString();
 }
 
+static
+void invocation_table_put(dumb_ptr<spell_t> spell)
+{
+    size_t mask = magic_conf.invocation_table.size() - 1;
+    size_t i = hash_key(spell->invocation) & mask;
+    while (magic_conf.invocation_table[i])
+        i = (i + 1) & mask;
+    magic_conf.invocation_table[i] = spell;
+}
+
+void magic_index_spell(dumb_ptr<spell_t> spell)
+{
+    XString invocation = spell->invocation;
+    if (!invocation)
+        return;
+    magic_conf.invocation_first.set(static_cast<uint8_t>(invocation.front()));
+    magic_conf.invocation_max_len = std::max(magic_conf.invocation_max_len, invocation.size());
+
+    size_t want = 16;
+    while (want < magic_conf.spells_by_invocation.size() * 2)
+        want *= 2;
+    if (want == magic_conf.invocation_table.size())
+    {
+        invocation_table_put(spell);
+        return;
+    }
+    magic_conf.invocation_table.assign(want, nullptr);
+    for (auto& pair : magic_conf.spells_by_invocation)
+        if (pair.first)
+            invocation_table_put(pair.second);
+}
+
+/*==========================================
+ * Most chat is not a spell, so this rejects a line on its first
+ * character or length before looking anything up, and never allocates.
+ *------------------------------------------
+ */
 dumb_ptr<spell_t> magic_find_spell(XString invocation)
 {
-    auto it = magic_conf.spells_by_invocation.find(invocation);
-    if (it != magic_conf.spells_by_invocation.end())
-        return it->second;
+    if (!invocation || invocation.size() > magic_conf.invocation_max_len
+            || !magic_conf.invocation_first.test(static_cast<uint8_t>(invocation.front())))
+        return nullptr;
+
+    size_t mask = magic_conf.invocation_table.size() - 1;
+    for (size_t i = hash_key(invocation) & mask;
+            magic_conf.invocation_table[i];
+            i = (i + 1) & mask)
+    {
+        dumb_ptr<spell_t> spell = magic_conf.invocation_table[i];
+        if (spell->invocation == invocation)
+            return spell;
+    }
 
     return nullptr;
 }
@@ -127,12 +174,20 @@ dumb_ptr<teleport_anchor_t> magic_find_anchor(XString name)
 /* Spell guard checks */
 /* -------------------------------------------------------------------------------- */
 
+// env_t itself comes from a pool, and the variable array of a freed
+// env is kept in magic_spare_vars (all reset to ValUndef), so casting
+// a spell normally allocates nothing for its environment.
 static
 dumb_ptr<env_t> alloc_env(magic_conf_t *conf)
 {
-    auto env = dumb_ptr<env_t>::make();
-    env->varu = make_unique<val_t[]>(conf->varv.size());
-    env->base_env = conf;
+    auto env = dumb_ptr<env_t>::make(conf);
+    if (!magic_spare_vars.empty())
+    {
+        env->varu = std::move(magic_spare_vars.back());
+        magic_spare_vars.pop_back();
+    }
+    else
+        env->varu = make_unique<val_t[]>(conf->varv.size());
     return env;
 }
 
@@ -150,9 +205,11 @@ dumb_ptr<env_t> clone_env(dumb_ptr<env_t> src)
 void magic_free_env(dumb_ptr<env_t> env)
 {
     for (int i = 0; i < env->base_env->varv.size(); i++)
+    {
         magic_clear_var(&env->varu[i]);
-    // handled by std::unique_ptr now. Was a memory leak before.
-    // delete[] env->vars;
+        env->varu[i] = ValUndef{};
+    }
+    magic_spare_vars.push_back(std::move(env->varu));
     env.delete_();
 }
 
@@ -77,6 +77,11 @@ int spell_unbind(dumb_ptr<map_session_data> subject, dumb_ptr<invocation> invoca
 dumb_ptr<invocation> spell_clone_effect(dumb_ptr<invocation> source);
 
 dumb_ptr<spell_t> magic_find_spell(XString invocation);
+/**
+ * Adds a spell, already in spells_by_invocation, to the index used
+ * by magic_find_spell()
+ */
+void magic_index_spell(dumb_ptr<spell_t> spell);
 
 void spell_update_location(dumb_ptr<invocation> invocation);
 } // namespace magic
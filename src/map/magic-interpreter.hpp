@@ -25,10 +25,13 @@
 
 #include <cassert>
 
+#include <bitset>
 #include <memory>
 
 #include "../strings/rstring.hpp"
 
+#include "../generic/object-pool.hpp"
+
 #include "../sexpr/variant.hpp"
 
 #include "../net/timer.t.hpp"
@@ -81,7 +84,7 @@ using AreaVariantBase = Variant<
     AreaBar
 >;
 
-struct area_t : AreaVariantBase
+struct area_t : AreaVariantBase, PoolAllocated<area_t, 256>
 {
     int size;
 
@@ -241,6 +244,8 @@ struct ExprFunApp
     fun_t *funp;
     int line_nr, column;
     int args_nr;
+    // bit i set if args[i] can't be type checked at load time
+    unsigned dynamic_args;
     dumb_ptr<expr_t> args[MAX_ARGS];
 };
 struct ExprId
@@ -325,6 +330,8 @@ struct EffectOp
     op_t *opp;
     int args_nr;
     int line_nr, column;
+    // as for ExprFunApp
+    unsigned dynamic_args;
     dumb_ptr<expr_t> args[MAX_ARGS];
 };
 struct EffectEnd
@@ -494,6 +501,13 @@ struct magic_conf_t
     std::vector<mcvar> varv;
 
     std::map<RString, dumb_ptr<spell_t>> spells_by_name, spells_by_invocation;
+    // Index over spells_by_invocation for magic_find_spell(), which sees
+    // every line of global chat. Maintained by magic_index_spell().
+    std::bitset<256> invocation_first;
+    size_t invocation_max_len = 0;
+    // open-addressed, size is a power of two and at least twice the
+    // number of spells
+    std::vector<dumb_ptr<spell_t>> invocation_table;
 
     std::map<RString, dumb_ptr<teleport_anchor_t>> anchors_by_name, anchors_by_invocation;
 };
@@ -511,11 +525,14 @@ struct magic_conf_t
 #define VAR_SCRIPTTARGET        7
 #define VAR_LOCATION            8
 
-struct env_t
+struct env_t : PoolAllocated<env_t, 64>
 {
-    magic_conf_t *base_env;
+    magic_conf_t *base_env = nullptr;
     std::unique_ptr<val_t[]> varu;
 
+    env_t() = default;
+    explicit env_t(magic_conf_t *conf) : base_env(conf) {}
+
     val_t& VAR(size_t i)
     {
         assert (varu);
@@ -576,7 +593,7 @@ struct status_change_ref_t
     BlockId bl_id;
 };
 
-struct invocation : block_list
+struct invocation : block_list, PoolAllocated<invocation, 64>
 {
     dumb_ptr<invocation> next_invocation; /* used for spells directly associated with a caster: they form a singly-linked list */
     INVOCATION_FLAG flags;
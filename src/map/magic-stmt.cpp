@@ -1428,6 +1428,7 @@ interval_t spell_run(dumb_ptr<invocation> invocation_, int allow_delete)
 
                 if (!magic_signature_check("effect"_s, op->name, op->signature,
                                             Slice<val_t>(args, e_op.args_nr),
+                                            e_op.dynamic_args,
                                             e_op.line_nr,
                                             e_op.column))
                     op->op(invocation_->env, Slice<val_t>(args, e_op.args_nr));
@@ -212,6 +212,7 @@ namespace magic_v2
             magic_conf.spells_by_name.erase(pair1.first);
             return false;
         }
+        magic_index_spell(spell);
         return true;
     }
     static
@@ -272,6 +273,31 @@ namespace magic_v2
         return true;
     }
     static
+    bool check_signature(io::LineSpan span, ZString kind, ZString name, ZString signature,
+            Slice<dumb_ptr<expr_t>> argv, unsigned *dynamic_args)
+    {
+        *dynamic_args = 0;
+        size_t i = 0;
+        auto sig = signature.begin();
+        for (dumb_ptr<expr_t> arg : argv)
+        {
+            switch (magic_static_match(*sig++, magic_static_type(arg)))
+            {
+                case StaticMatch::NEVER:
+                    span.error(STRPRINTF("Argument #%zu to %s '%s' is of incorrect type"_fmt,
+                                i + 1, kind, name));
+                    return false;
+                case StaticMatch::DYNAMIC:
+                    *dynamic_args |= 1U << i;
+                    break;
+                case StaticMatch::ALWAYS:
+                    break;
+            }
+            ++i;
+        }
+        return true;
+    }
+    static
     bool op_effect(io::LineSpan span, ZString name, Slice<dumb_ptr<expr_t>> argv, dumb_ptr<effect_t>& effect)
     {
         op_t *op = magic_get_op(name);
@@ -288,6 +314,8 @@ namespace magic_v2
         }
 
         EffectOp e_op;
+        if (!check_signature(span, "operation"_s, name, op->signature, argv, &e_op.dynamic_args))
+            return false;
         e_op.line_nr = span.begin.line;
         e_op.column = span.begin.column;
         e_op.opp = op;
@@ -325,6 +353,8 @@ namespace magic_v2
             return false;
         }
         ExprFunApp e_funapp;
+        if (!check_signature(span, "function"_s, name, fun->signature, argv, &e_funapp.dynamic_args))
+            return false;
         e_funapp.line_nr = span.begin.line;
         e_funapp.column = span.begin.column;
         e_funapp.funp = fun;
@@ -78,6 +78,7 @@
 #include "npc-parse.hpp"
 #include "party.hpp"
 #include "pc.hpp"
+#include "script-cache.hpp"
 #include "script-startup.hpp"
 #include "skill.hpp"
 #include "storage.hpp"
@@ -635,6 +636,45 @@ void map_clearflooritem_timer(TimerData *tid, tick_t, BlockId id)
     map_delobject(fitem->bl_id, BL::ITEM);
 }
 
+/// Collect the walkable cells in [x0, x1] × [y0, y1], packed as x + y * xs.
+std::vector<uint32_t> map_freecells(Borrowed<map_local> m,
+        int x0, int y0, int x1, int y1)
+{
+    std::vector<uint32_t> cells;
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, m->xs - 1);
+    y1 = std::min(y1, m->ys - 1);
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+            if (!bool(map_getcell(m, x, y) & MapCell::UNWALKABLE))
+                cells.push_back(x + y * m->xs);
+    return cells;
+}
+
+/// Same as map_freecells(), but cached for the lifetime of the map,
+/// since many mob spawns share the same rectangle.
+Borrowed<const std::vector<uint32_t>> map_spawncells(Borrowed<map_local> m,
+        int x0, int y0, int x1, int y1)
+{
+    auto key = std::make_tuple(x0, y0, x1, y1);
+    auto it = m->spawn_cells.find(key);
+    if (it == m->spawn_cells.end())
+        it = m->spawn_cells.insert({key, map_freecells(m, x0, y0, x1, y1)}).first;
+    return Borrowed<const std::vector<uint32_t>>(&it->second);
+}
+
+/// Return a random cell from a list made by map_freecells(),
+/// or (0, 0) if it is empty.
+std::pair<uint16_t, uint16_t> map_pickcell(Borrowed<map_local> m,
+        const std::vector<uint32_t>& cells)
+{
+    if (cells.empty())
+        return {0_u16, 0_u16};
+    uint32_t c = random_::choice(cells);
+    return {static_cast<uint16_t>(c % m->xs), static_cast<uint16_t>(c / m->xs)};
+}
+
 std::pair<uint16_t, uint16_t> map_randfreecell(Borrowed<map_local> m,
         uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 {
@@ -1278,6 +1318,9 @@ bool map_readmap(map_local *m, size_t num, MapName fn)
     size_t bys = (ys + BLOCK_SIZE - 1) / BLOCK_SIZE;
     m->blocks.reset(bxs, bys);
 
+    // for mobs that spawn anywhere on the map
+    m->free_cells = map_freecells(borrow(*m), 1, 1, xs - 2, ys - 2);
+
     return true;
 }
 
@@ -1614,6 +1657,7 @@ int do_init(Slice<ZString> argv)
         runflag &= load_config_file("conf/tmwa-map.conf"_s, map_confs);
 
     map_set_logfile();
+    script_cache_init();
 
     runflag &= map_readallmap();
 
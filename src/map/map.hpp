@@ -27,6 +27,9 @@
 #include <chrono>
 #include <functional>
 #include <list>
+#include <map>
+#include <tuple>
+#include <vector>
 
 #include "../ints/udl.hpp"
 
@@ -37,6 +40,7 @@
 #include "../generic/db.hpp"
 #include "../generic/dumb_ptr.hpp"
 #include "../generic/matrix.hpp"
+#include "../generic/object-pool.hpp"
 
 #include "../net/socket.hpp"
 #include "../net/timer.t.hpp"
@@ -48,6 +52,7 @@
 #include "script-buffer.hpp"
 #include "script-persist.hpp"
 #include "../mmo/skill.t.hpp"
+#include "walk.t.hpp"
 
 
 namespace tmwa
@@ -181,7 +186,7 @@ struct map_session_data : block_list, SessionData
     Opt3 opt3;
     DIR dir, head_dir;
     struct walkpath_data walkpath;
-    Timer walktimer;
+    WalkStep walktimer;
     BlockId npc_id, areanpc_id, npc_shopid;
     // this is important
     int npc_pos;
@@ -256,10 +261,11 @@ struct map_session_data : block_list, SessionData
 
     // register keys are ints (interned)
     // Not anymore! Well, sort of.
-    DMap<SIR, int> regm;
-    // can't be DMap because we want predictable .c_str()s
-    // TODO this can change now
-    Map<SIR, RString> regstrm;
+    SIRMap<int> regm;
+    SIRMap<RString> regstrm;
+    // slot in status.global_reg, account_reg and account_reg2,
+    // by interned name; see pc_reindexreg()
+    Map<SIR, int> global_reg_index, account_reg_index, account_reg2_index;
 
     earray<struct status_change, StatusChange, StatusChange::MAX_STATUSCHANGE> sc_data;
 
@@ -398,7 +404,7 @@ public:
     } warp;
 };
 
-class npc_data_message : public npc_data
+class npc_data_message : public npc_data, public PoolAllocated<npc_data_message, 32>
 {
 public:
     RString message;
@@ -407,7 +413,7 @@ public:
 constexpr int MOB_XP_BONUS_BASE = 1024;
 constexpr int MOB_XP_BONUS_SHIFT = 10;
 
-struct mob_data : block_list
+struct mob_data : block_list, PoolAllocated<mob_data, 64>
 {
     short n;
     Species mob_class;
@@ -418,6 +424,8 @@ struct mob_data : block_list
         Borrowed<map_local> m = borrow(undefined_gat);
         short x0, y0, xs, ys;
         interval_t delay1, delay2;
+        // walkable cells of the area, owned by m
+        Option<Borrowed<const std::vector<uint32_t>>> cells = None;
     } spawn;
     MobName name;
     struct
@@ -434,6 +442,7 @@ struct mob_data : block_list
         unsigned special_mob_ai:3;
     } state;
     Timer timer;
+    WalkStep walktimer;
     short to_x, to_y;
     int hp;
     BlockId target_id, attacked_id;
@@ -481,6 +490,8 @@ struct mob_data : block_list
 struct BlockLists
 {
     dumb_ptr<block_list> normal, mobs_only;
+    // last mob_ai_hard() pass that collected all of this block
+    uint32_t ai_pass;
 };
 
 struct map_abstract
@@ -504,6 +515,10 @@ struct map_local : map_abstract
     Point save;
     Point resave;
     Array<dumb_ptr<npc_data>, MAX_NPC_PER_MAP> npc;
+    // walkable cells (as x + y * xs) of the whole map,
+    // and of each mob spawn rectangle (x0, y0, x1, y1)
+    std::vector<uint32_t> free_cells;
+    std::map<std::tuple<int, int, int, int>, std::vector<uint32_t>> spawn_cells;
 };
 
 struct map_remote : map_abstract
@@ -520,7 +535,7 @@ MapCell read_gatp(Borrowed<map_local> m, int x, int y)
     return m->gat[x + y * m->xs];
 }
 
-struct flooritem_data : block_list
+struct flooritem_data : block_list, PoolAllocated<flooritem_data, 256>
 {
     short subx, suby;
     Timer cleartimer;
@@ -664,6 +679,12 @@ void map_setcell(Borrowed<map_local>, int, int, MapCell);
 bool map_check_dir(DIR s_dir, DIR t_dir);
 DIR map_calc_dir(dumb_ptr<block_list> src, int x, int y);
 
+std::vector<uint32_t> map_freecells(Borrowed<map_local> m,
+        int x0, int y0, int x1, int y1);
+Borrowed<const std::vector<uint32_t>> map_spawncells(Borrowed<map_local> m,
+        int x0, int y0, int x1, int y1);
+std::pair<uint16_t, uint16_t> map_pickcell(Borrowed<map_local> m,
+        const std::vector<uint32_t>& cells);
 std::pair<uint16_t, uint16_t> map_randfreecell(Borrowed<map_local> m,
         uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 
@@ -57,6 +57,7 @@
 #include "path.hpp"
 #include "pc.hpp"
 #include "skill.hpp"
+#include "walk.hpp"
 
 #include "../poison.hpp"
 
@@ -88,6 +89,8 @@ int mob_makedummymobdb(Species);
 static
 void mob_timer(TimerData *, tick_t, BlockId, unsigned char);
 static
+void mob_walk_timer(dumb_ptr<block_list>, tick_t, unsigned char);
+static
 int mobskill_use_id(dumb_ptr<mob_data> md, dumb_ptr<block_list> target,
         mob_skill& skill_idx);
 
@@ -681,9 +684,7 @@ int mob_walk(dumb_ptr<mob_data> md, tick_t tick, unsigned char data)
         i = i / 2;
         if (md->walkpath.path_half == 0)
             i = std::max(i, 1_ms);
-        md->timer = Timer(tick + i,
-                std::bind(mob_timer, ph::_1, ph::_2,
-                    md->bl_id, md->walkpath.path_pos));
+        walk_schedule(md, tick + i, mob_walk_timer, md->walkpath.path_pos);
         md->state.state = MS::WALK;
 
         if (md->walkpath.path_pos >= md->walkpath.path_len)
@@ -865,6 +866,7 @@ int mob_changestate(dumb_ptr<mob_data> md, MS state, bool type)
     nullpo_retz(md);
 
     md->timer.cancel();
+    md->walktimer.cancel();
     md->state.state = state;
 
     switch (state)
@@ -875,9 +877,7 @@ int mob_changestate(dumb_ptr<mob_data> md, MS state, bool type)
             if (i > interval_t::zero())
             {
                 i = i / 4;
-                md->timer = Timer(gettick() + i,
-                        std::bind(mob_timer, ph::_1, ph::_2,
-                            md->bl_id, 0));
+                walk_schedule(md, gettick() + i, mob_walk_timer, 0);
             }
             else
                 md->state.state = MS::IDLE;
@@ -928,11 +928,10 @@ int mob_changestate(dumb_ptr<mob_data> md, MS state, bool type)
 
 /*==========================================
  * timer processing of mob (timer function)
- * It branches to a walk and an attack.
  *------------------------------------------
  */
 static
-void mob_timer(TimerData *, tick_t tick, BlockId id, unsigned char data)
+void mob_timer(TimerData *, tick_t tick, BlockId id, unsigned char)
 {
     dumb_ptr<mob_data> md;
     dumb_ptr<block_list> bl;
@@ -953,10 +952,6 @@ void mob_timer(TimerData *, tick_t tick, BlockId id, unsigned char data)
     MapBlockLock lock;
     switch (md->state.state)
     {
-        case MS::WALK:
-            mob_check_attack(md);
-            mob_walk(md, tick, data);
-            break;
         case MS::ATTACK:
             mob_attack(md, tick);
             break;
@@ -968,6 +963,22 @@ void mob_timer(TimerData *, tick_t tick, BlockId id, unsigned char data)
     }
 }
 
+/*==========================================
+ * walk processing of mob (walk queue function)
+ *------------------------------------------
+ */
+static
+void mob_walk_timer(dumb_ptr<block_list> bl, tick_t tick, unsigned char data)
+{
+    dumb_ptr<mob_data> md = bl->is_mob();
+
+    if (md->bl_prev == nullptr || md->state.state != MS::WALK)
+        return;
+
+    mob_check_attack(md);
+    mob_walk(md, tick, data);
+}
+
 /*==========================================
  *
  *------------------------------------------
@@ -1106,36 +1117,56 @@ int mob_spawn(BlockId id)
     }
 
     md->bl_m = md->spawn.m;
+    OMATCH_BEGIN (md->spawn.cells)
     {
-        int i = 0;
-        do
+        OMATCH_CASE_SOME (cells)
         {
-            if (md->spawn.x0 == 0 && md->spawn.y0 == 0)
+            // precomputed by npc_load_monster, so one draw is enough
+            if (cells->empty())
             {
-                x = random_::in(1, md->bl_m->xs - 2);
-                y = random_::in(1, md->bl_m->ys - 2);
+                Timer(tick + 5_s,
+                        std::bind(mob_delayspawn, ph::_1, ph::_2,
+                            id)
+                ).detach();
+                return 1;
             }
-            else
+            auto xy = map_pickcell(md->bl_m, *cells);
+            x = xy.first;
+            y = xy.second;
+        }
+        OMATCH_CASE_NONE ()
+        {
+            int i = 0;
+            do
             {
-                // TODO: move this logic earlier - possibly all the way
-                // into the data files
-                x = md->spawn.x0 - md->spawn.xs / 2 + random_::in(0, md->spawn.xs);
-                y = md->spawn.y0 - md->spawn.ys / 2 + random_::in(0, md->spawn.ys);
+                if (md->spawn.x0 == 0 && md->spawn.y0 == 0)
+                {
+                    x = random_::in(1, md->bl_m->xs - 2);
+                    y = random_::in(1, md->bl_m->ys - 2);
+                }
+                else
+                {
+                    // TODO: move this logic earlier - possibly all the way
+                    // into the data files
+                    x = md->spawn.x0 - md->spawn.xs / 2 + random_::in(0, md->spawn.xs);
+                    y = md->spawn.y0 - md->spawn.ys / 2 + random_::in(0, md->spawn.ys);
+                }
+                i++;
             }
-            i++;
-        }
-        while (bool(map_getcell(md->bl_m, x, y) & MapCell::UNWALKABLE)
-            && i < 50);
+            while (bool(map_getcell(md->bl_m, x, y) & MapCell::UNWALKABLE)
+                && i < 50);
 
-        if (i >= 50)
-        {
-            Timer(tick + 5_s,
-                    std::bind(mob_delayspawn, ph::_1, ph::_2,
-                        id)
-            ).detach();
-            return 1;
+            if (i >= 50)
+            {
+                Timer(tick + 5_s,
+                        std::bind(mob_delayspawn, ph::_1, ph::_2,
+                            id)
+                ).detach();
+                return 1;
+            }
         }
     }
+    OMATCH_END ();
 
     md->to_x = md->bl_x = x;
     md->to_y = md->bl_y = y;
@@ -1158,6 +1189,7 @@ int mob_spawn(BlockId id)
     md->state.state = MS::IDLE;
     md->state.skillstate = MobSkillState::MSS_IDLE;
     assert (!md->timer);
+    assert (!md->walktimer);
     md->last_thinktime = tick;
     md->next_walktime = tick + 5_s + std::chrono::milliseconds(random_::to(50));
     md->attackabletime = tick;
@@ -1917,7 +1949,8 @@ void mob_ai_sub_hard(dumb_ptr<block_list> bl, tick_t tick)
                         return;
                     md->state.skillstate = MobSkillState::MSS_CHASE;   // 突撃時スキル
                     mobskill_use(md, tick, MobSkillCondition::ANY);
-                    if (md->timer && md->state.state != MS::ATTACK
+                    if ((md->walktimer
+                            || (md->timer && md->state.state != MS::ATTACK))
                         && (md->next_walktime < tick
                             || distance(md->to_x, md->to_y, tbl->bl_x, tbl->bl_y) < 2))
                         return;   // 既に移動中
@@ -2006,7 +2039,8 @@ void mob_ai_sub_hard(dumb_ptr<block_list> bl, tick_t tick)
                         return;
                     md->state.skillstate = MobSkillState::MSS_LOOT;    // ルート時スキル使用
                     mobskill_use(md, tick, MobSkillCondition::ANY);
-                    if (md->timer && md->state.state != MS::ATTACK
+                    if ((md->walktimer
+                            || (md->timer && md->state.state != MS::ATTACK))
                         && (md->next_walktime < tick
                             || distance(md->to_x, md->to_y, tbl->bl_x, tbl->bl_y) <= 0))
                         return;   // 既に移動中
@@ -2076,15 +2110,44 @@ void mob_ai_sub_hard(dumb_ptr<block_list> bl, tick_t tick)
  *------------------------------------------
  */
 static
-void mob_ai_sub_foreachclient(dumb_ptr<map_session_data> sd, tick_t tick)
+void mob_ai_sub_foreachclient(dumb_ptr<map_session_data> sd)
 {
     nullpo_retv(sd);
 
-    map_foreachinarea(std::bind(mob_ai_sub_hard, ph::_1, tick),
-            sd->bl_m,
-            sd->bl_x - AREA_SIZE * 2, sd->bl_y - AREA_SIZE * 2,
-            sd->bl_x + AREA_SIZE * 2, sd->bl_y + AREA_SIZE * 2,
-            BL::MOB);
+    Borrowed<map_local> m = sd->bl_m;
+    int x0 = std::max(sd->bl_x - AREA_SIZE * 2, 0);
+    int y0 = std::max(sd->bl_y - AREA_SIZE * 2, 0);
+    int x1 = std::min(sd->bl_x + AREA_SIZE * 2, m->xs - 1);
+    int y1 = std::min(sd->bl_y + AREA_SIZE * 2, m->ys - 1);
+
+    // Players standing together share most of their view, so a block
+    // that lies wholly inside the window is collected only once per
+    // pass.  This keeps a crowded map from costing (players * area) on
+    // every think.  The blocks on the edge of the window are still
+    // filtered by cell, so the area is exactly what it always was; a
+    // mob collected twice is turned away by its last_thinktime.
+    for (int by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++)
+    {
+        for (int bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++)
+        {
+            BlockLists& b = m->blocks.ref(bx, by);
+            if (b.ai_pass == mob_ai_pass)
+                continue;
+            bool whole = bx * BLOCK_SIZE >= x0
+                && std::min<int>((bx + 1) * BLOCK_SIZE, m->xs) - 1 <= x1
+                && by * BLOCK_SIZE >= y0
+                && std::min<int>((by + 1) * BLOCK_SIZE, m->ys) - 1 <= y1;
+            if (whole)
+                b.ai_pass = mob_ai_pass;
+            for (dumb_ptr<block_list> bl = b.mobs_only; bl; bl = bl->bl_next)
+            {
+                if (whole
+                    || (bl->bl_x >= x0 && bl->bl_x <= x1
+                        && bl->bl_y >= y0 && bl->bl_y <= y1))
+                    mob_ai_list.push_back(bl);
+            }
+        }
+    }
 }
 
 /*==========================================
@@ -2094,7 +2157,15 @@ void mob_ai_sub_foreachclient(dumb_ptr<map_session_data> sd, tick_t tick)
 static
 void mob_ai_hard(TimerData *, tick_t tick)
 {
-    clif_foreachclient(std::bind(mob_ai_sub_foreachclient, ph::_1, tick));
+    if (!++mob_ai_pass)
+        ++mob_ai_pass;
+    mob_ai_list.clear();
+    clif_foreachclient(mob_ai_sub_foreachclient);
+
+    MapBlockLock lock;
+    for (dumb_ptr<block_list> bl : mob_ai_list)
+        if (bl->bl_prev)
+            mob_ai_sub_hard(bl, tick);
 }
 
 /*==========================================
@@ -3264,12 +3335,7 @@ int mobskill_use_pos(dumb_ptr<mob_data> md,
 int mobskill_use(dumb_ptr<mob_data> md, tick_t tick,
         MobSkillCondition event)
 {
-    int max_hp;
-
     nullpo_retz(md);
-    std::vector<mob_skill>& ms = get_mob_db(md->mob_class).skills;
-
-    max_hp = battle_get_max_hp(md);
 
     if (battle_config.mob_skill_use == 0 || md->skilltimer)
         return 0;
@@ -3277,19 +3343,30 @@ int mobskill_use(dumb_ptr<mob_data> md, tick_t tick,
     if (md->state.special_mob_ai)
         return 0;
 
-    for (mob_skill& msii : ms)
+    // 状態判定
+    // Only the skills usable in the current state are considered;
+    // the lists are built by mob_index_skills().
+    if (md->state.skillstate == MobSkillState::ANY)
+        return 0;
+    mob_db_& db = get_mob_db(md->mob_class);
+    const std::vector<uint16_t>& candidates = db.skills_by_state[md->state.skillstate];
+    if (candidates.empty())
+        return 0;
+
+    int max_hp = battle_get_max_hp(md);
+    // mob_countslave() scans the whole map, so do it at most once
+    int slaves = -1;
+
+    for (uint16_t i : candidates)
     {
-        tick_t& sdii = md->skilldelayup[&msii - &ms.front()];
+        mob_skill& msii = db.skills[i];
+        tick_t& sdii = md->skilldelayup[i];
         int flag = 0;
 
         // ディレイ中
         if (tick < sdii + msii.delay)
             continue;
 
-        // 状態判定
-        if (msii.state != MobSkillState::ANY && msii.state != md->state.skillstate)
-            continue;
-
         // Note: these *may* both be MobSkillCondition::ANY
         flag = (event == msii.cond1);
         if (!flag)
@@ -3306,10 +3383,14 @@ int mobskill_use(dumb_ptr<mob_data> md, tick_t tick,
                     flag = !md->bl_m->flag.get(MapFlag::TOWN);
                     break;
                 case MobSkillCondition::MSC_SLAVELT:  // slave < num
-                    flag = (mob_countslave(md) < msii.cond2i);
+                    if (slaves < 0)
+                        slaves = mob_countslave(md);
+                    flag = (slaves < msii.cond2i);
                     break;
                 case MobSkillCondition::MSC_SLAVELE:  // slave <= num
-                    flag = (mob_countslave(md) <= msii.cond2i);
+                    if (slaves < 0)
+                        slaves = mob_countslave(md);
+                    flag = (slaves <= msii.cond2i);
                     break;
             }
         }
@@ -3441,6 +3522,16 @@ bool impl_extract(XString str, LevelElement *le)
     return false;
 }
 
+/// Forget the skills of a mob, along with their buckets, which
+/// would otherwise point past the end of the list.
+static
+void mob_clear_skills(mob_db_& db)
+{
+    db.skills.clear();
+    for (std::vector<uint16_t>& bucket : db.skills_by_state)
+        bucket.clear();
+}
+
 bool mob_readdb(ZString filename)
 {
     bool rv = true;
@@ -3565,7 +3656,7 @@ bool mob_readdb(ZString filename)
             }
 
 
-            get_mob_db(mob_class).skills.clear();
+            mob_clear_skills(get_mob_db(mob_class));
 
             get_mob_db(mob_class).hair = 0;
             get_mob_db(mob_class).hair_color = 0;
@@ -3652,6 +3743,30 @@ bool impl_extract(XString str, MobSkillTarget *mst)
     return false;
 }
 
+/*==========================================
+ * Bucket the skills of each mob by the state they may be used in,
+ * so that mobskill_use() need not filter the whole list on every think.
+ * Must be called again whenever the skills change.
+ *------------------------------------------
+ */
+void mob_index_skills(void)
+{
+    for (mob_db_& db : mob_db)
+    {
+        for (MobSkillState mss : erange(MobSkillState(), MobSkillState::COUNT))
+        {
+            std::vector<uint16_t>& bucket = db.skills_by_state[mss];
+            bucket.clear();
+            for (size_t i = 0; i < db.skills.size(); ++i)
+            {
+                MobSkillState want = db.skills[i].state;
+                if (want == MobSkillState::ANY || want == mss)
+                    bucket.push_back(i);
+            }
+        }
+    }
+}
+
 bool mob_readskilldb(ZString filename)
 {
     bool rv = true;
@@ -3673,7 +3788,7 @@ bool mob_readskilldb(ZString filename)
             XString blah;
             if (extract(line, record<','>(&mob_id, &blah)) && mobdb_checkid(mob_id) != Species() && blah == "clear"_s)
             {
-                get_mob_db(mob_id).skills.clear();
+                mob_clear_skills(get_mob_db(mob_id));
                 continue;
             }
 
@@ -3736,6 +3851,8 @@ bool mob_readskilldb(ZString filename)
 
 void do_init_mob2(void)
 {
+    // after both mob_db and mob_skill_db, which may come in any order
+    mob_index_skills();
     Timer(gettick() + MIN_MOBTHINKTIME,
             mob_ai_hard,
             MIN_MOBTHINKTIME
@@ -85,6 +85,8 @@ struct mob_db_
     short option, clothes_color; // [Valaris]
     int equip;                 // [Valaris]
     std::vector<struct mob_skill> skills;
+    // indices into skills usable in each state, in file order
+    earray<std::vector<uint16_t>, MobSkillState, MobSkillState::COUNT> skills_by_state;
 };
 struct mob_db_& get_mob_db(Species);
 
@@ -117,6 +119,7 @@ int mob_get_equip(Species);       // mob equip [Valaris]
 
 bool mob_readdb(ZString filename);
 bool mob_readskilldb(ZString filename);
+void mob_index_skills(void);
 void do_init_mob2(void);
 
 int mob_delete(dumb_ptr<mob_data> md);
@@ -62,6 +62,8 @@ enum class MobSkillState : uint8_t
     MSS_DEAD,
     MSS_LOOT,
     MSS_CHASE,
+
+    COUNT,
 };
 } // namespace map
 } // namespace tmwa
@@ -0,0 +1,100 @@
+#include "mob.hpp"
+//    mob_test.cpp - Testsuite for the mob database
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "../strings/xstring.hpp"
+#include "../strings/zstring.hpp"
+#include "../strings/literal.hpp"
+
+#include "../io/fd.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+class SkillFile
+{
+    char name[32] = "/tmp/tmwa-mob-test-XXXXXX";
+public:
+    SkillFile(XString content)
+    {
+        io::FD fd = io::FD::cast_dammit(mkstemp(name));
+        if (fd.write(content.data(), content.size()) != content.size())
+            name[0] = '\0';
+        fd.close();
+    }
+    ~SkillFile()
+    {
+        unlink(name);
+    }
+    ZString path()
+    {
+        return ZString(strings::really_construct_from_a_pointer, name, nullptr);
+    }
+};
+
+static
+bool buckets_in_range(const mob_db_& db)
+{
+    for (const std::vector<uint16_t>& bucket : db.skills_by_state)
+        for (uint16_t i : bucket)
+            if (i >= db.skills.size())
+                return false;
+    return true;
+}
+
+TEST(mob, skillreload)
+{
+    mob_db_& db = get_mob_db(wrap<Species>(1002));
+
+    SkillFile first(
+            "1002,a,idle,340,1,10000,0,0,no,self,always,0,0,0,0,0,0\n"
+            "1002,b,attack,340,1,10000,0,0,no,self,always,0,0,0,0,0,0\n"
+            "1002,c,any,340,1,10000,0,0,no,self,always,0,0,0,0,0,0\n"_s);
+    ASSERT_TRUE(mob_readskilldb(first.path()));
+    mob_index_skills();
+    ASSERT_EQ(db.skills.size(), 3u);
+    EXPECT_EQ(db.skills_by_state[MobSkillState::MSS_IDLE].size(), 2u);
+    EXPECT_EQ(db.skills_by_state[MobSkillState::MSS_ATTACK].size(), 2u);
+    EXPECT_EQ(db.skills_by_state[MobSkillState::MSS_WALK].size(), 1u);
+
+    SkillFile second(
+            "1002,clear\n"
+            "1002,d,walk,340,1,10000,0,0,no,self,always,0,0,0,0,0,0\n"_s);
+    ASSERT_TRUE(mob_readskilldb(second.path()));
+    // even before they are rebuilt, no bucket points past the end
+    ASSERT_EQ(db.skills.size(), 1u);
+    EXPECT_TRUE(buckets_in_range(db));
+
+    mob_index_skills();
+    EXPECT_TRUE(buckets_in_range(db));
+    EXPECT_EQ(db.skills_by_state[MobSkillState::MSS_IDLE].size(), 0u);
+    EXPECT_EQ(db.skills_by_state[MobSkillState::MSS_WALK].size(), 1u);
+}
+} // namespace map
+} // namespace tmwa
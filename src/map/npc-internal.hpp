@@ -33,5 +33,7 @@ struct event_data
     dumb_ptr<npc_data_script> nd;
     int pos;
 };
+
+void npc_register_event(NpcEvent key, event_data ev);
 } // namespace map
 } // namespace tmwa
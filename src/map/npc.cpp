@@ -183,60 +183,60 @@ int npc_delete(dumb_ptr<npc_data> nd)
 }
 
 /*==========================================
- * 全てのNPCのOn*イベント実行
+ * イベントの登録
  *------------------------------------------
  */
+template<class T>
 static
-void npc_event_doall_sub(NpcEvent key, struct event_data *ev,
-        int *c, ScriptLabel name, BlockId rid, Slice<argrec_t> argv)
+void npc_event_index(std::vector<T>& v, T k)
 {
-    ScriptLabel p = key.label;
-
-    nullpo_retv(ev);
+    auto it = std::lower_bound(v.begin(), v.end(), k);
+    if (it == v.end() || !(*it == k))
+        v.insert(it, k);
+}
 
-    if (name == p)
-    {
-        run_script_l(ScriptPointer(borrow(*ev->nd->scr.script), ev->pos), rid, ev->nd->bl_id,
-                argv);
-        (*c)++;
-    }
+void npc_register_event(NpcEvent key, event_data ev)
+{
+    ev_db.insert(key, ev);
+    npc_event_index(*ev_db_by_label.init(key.label), key);
+    npc_event_index(*ev_db_by_npc.init(key.npc), key.label);
 }
 
-int npc_event_doall_l(ScriptLabel name, BlockId rid, Slice<argrec_t> args)
+/*==========================================
+ * 全てのNPCのOn*イベント実行
+ *------------------------------------------
+ */
+static
+int npc_event_run(NpcEvent key, BlockId rid, Slice<argrec_t> argv)
 {
-    int c = 0;
+    P<struct event_data> ev = TRY_UNWRAP(ev_db.search(key), return 0);
 
-    for (auto& pair : ev_db)
-        npc_event_doall_sub(pair.first, &pair.second, &c, name, rid, args);
-    return c;
+    run_script_l(ScriptPointer(borrow(*ev->nd->scr.script), ev->pos), rid, ev->nd->bl_id,
+            argv);
+    return 1;
 }
 
-static
-void npc_event_do_sub(NpcEvent key, struct event_data *ev,
-        int *c, NpcEvent name, BlockId rid, Slice<argrec_t> argv)
+int npc_event_doall_l(ScriptLabel name, BlockId rid, Slice<argrec_t> args)
 {
-    nullpo_retv(ev);
+    int c = 0;
 
-    if (name == key)
+    OMATCH_BEGIN_SOME (keys, ev_db_by_label.search(name))
     {
-        run_script_l(ScriptPointer(borrow(*ev->nd->scr.script), ev->pos), rid, ev->nd->bl_id,
-                argv);
-        (*c)++;
+        for (NpcEvent key : *keys)
+            c += npc_event_run(key, rid, args);
     }
+    OMATCH_END ();
+    return c;
 }
 
 int npc_event_do_l(NpcEvent name, BlockId rid, Slice<argrec_t> args)
 {
-    int c = 0;
-
     if (!name.npc)
     {
         return npc_event_doall_l(name.label, rid, args);
     }
 
-    for (auto& pair : ev_db)
-        npc_event_do_sub(pair.first, &pair.second, &c, name, rid, args);
-    return c;
+    return npc_event_run(name, rid, args);
 }
 
 /*==========================================
@@ -482,23 +482,26 @@ int npc_event(dumb_ptr<map_session_data> sd, NpcEvent eventname,
     return 0;
 }
 
-static
-void npc_command_sub(NpcEvent key, struct event_data *ev, NpcName npcname, XString command)
+int npc_command(dumb_ptr<map_session_data>, NpcName npcname, XString command)
 {
-    if (ev->nd->name == npcname
-        && key.label.startswith("OnCommand"_s))
+    OMATCH_BEGIN_SOME (labels, ev_db_by_npc.search(npcname))
     {
-        XString temp = key.label.xslice_t(9);
+        for (ScriptLabel label : *labels)
+        {
+            if (!label.startswith("OnCommand"_s))
+                continue;
+            XString temp = label.xslice_t(9);
+            if (command != temp)
+                continue;
 
-        if (command == temp)
+            NpcEvent key;
+            key.npc = npcname;
+            key.label = label;
+            P<struct event_data> ev = TRY_UNWRAP(ev_db.search(key), continue);
             run_script(ScriptPointer(borrow(*ev->nd->scr.script), ev->pos), BlockId(), ev->nd->bl_id);
+        }
     }
-}
-
-int npc_command(dumb_ptr<map_session_data>, NpcName npcname, XString command)
-{
-    for (auto& pair : ev_db)
-        npc_command_sub(pair.first, &pair.second, npcname, command);
+    OMATCH_END ();
 
     return 0;
 }
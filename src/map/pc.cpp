@@ -34,6 +34,7 @@
 #include "../strings/zstring.hpp"
 #include "../strings/literal.hpp"
 
+#include "../generic/intern-pool.hpp"
 #include "../generic/random.hpp"
 
 #include "../io/cxxstdio.hpp"
@@ -64,6 +65,7 @@
 #include "skill.hpp"
 #include "storage.hpp"
 #include "trade.hpp"
+#include "walk.hpp"
 
 #include "../poison.hpp"
 
@@ -632,6 +634,7 @@ int pc_authok(AccountId id, int login_id2,
 
     sd->status_key = *st_key;
     sd->status = *st_data;
+    pc_reindexreg(sd);
 
     if (sd->status.sex != sd->sex)
     {
@@ -2332,16 +2335,12 @@ interval_t calc_next_walk_step(dumb_ptr<map_session_data> sd)
  *------------------------------------------
  */
 static
-void pc_walk(TimerData *, tick_t tick, BlockId id, unsigned char data)
+void pc_walk(dumb_ptr<block_list> bl, tick_t tick, unsigned char data)
 {
-    dumb_ptr<map_session_data> sd;
+    dumb_ptr<map_session_data> sd = bl->is_player();
     int moveblock;
     int x, y, dx, dy;
 
-    sd = map_id2sd(id);
-    if (sd == nullptr)
-        return;
-
     if (sd->walkpath.path_pos >= sd->walkpath.path_len
         || sd->walkpath.path_pos != data)
         return;
@@ -2436,9 +2435,7 @@ void pc_walk(TimerData *, tick_t tick, BlockId id, unsigned char data)
         if (sd->walkpath.path_half == 0)
             i = std::max(i, 1_ms);
 
-        sd->walktimer = Timer(tick + i,
-                std::bind(pc_walk, ph::_1, ph::_2,
-                    id, sd->walkpath.path_pos));
+        walk_schedule(sd, tick + i, pc_walk, sd->walkpath.path_pos);
     }
 }
 
@@ -2464,9 +2461,7 @@ int pc_walktoxy_sub(dumb_ptr<map_session_data> sd)
     if (i > interval_t::zero())
     {
         i = i / 4;
-        sd->walktimer = Timer(gettick() + i,
-                std::bind(pc_walk, ph::_1, ph::_2,
-                    sd->bl_id, 0));
+        walk_schedule(sd, gettick() + i, pc_walk, 0);
     }
     clif_movechar(sd);
 
@@ -3842,225 +3837,236 @@ void pc_setregstr(dumb_ptr<map_session_data> sd, SIR reg, RString str)
 {
     nullpo_retv(sd);
 
-    if (!str)
+    sd->regstrm.put(reg, str);
+}
+
+/*==========================================
+ * script用変数の索引
+ * global_reg, account_reg and account_reg2 stay flat arrays, since
+ * that is what gets sent to the char server, but each has an index
+ * from the interned name to its slot, so that a lookup is a few
+ * integer compares instead of up to GLOBAL_REG_NUM VarName compares.
+ *------------------------------------------
+ */
+static
+SIR pc_regkey(VarName reg)
+{
+    return SIR::from(variable_names.intern(reg));
+}
+
+static
+void pc_regindex_build(Map<SIR, int>& index, const GlobalReg *regs, int num)
+{
+    index.clear();
+    for (int i = 0; i < num; i++)
+        index.insert(pc_regkey(regs[i].str), i);
+}
+
+static
+int pc_regindex_read(const Map<SIR, int>& index, const GlobalReg *regs, SIR key)
+{
+    Option<Borrowed<const int>> slot = index.search(SIR::from(key.base()));
+    OMATCH_BEGIN_SOME (i, slot)
     {
-        sd->regstrm.erase(reg);
-        return;
+        return regs[*i].value;
+    }
+    OMATCH_END ();
+    return 0;
+}
+
+/// Returns false if the variable is new and there is no room for it.
+static
+bool pc_regindex_set(Map<SIR, int>& index, GlobalReg *regs, int32_t *num, int max,
+        SIR key, int val)
+{
+    key = SIR::from(key.base());
+    Option<Borrowed<int>> slot = index.search(key);
+    OMATCH_BEGIN (slot)
+    {
+        OMATCH_CASE_SOME (i)
+        {
+            if (val != 0)
+            {
+                regs[*i].value = val;
+                return true;
+            }
+            int last = *num - 1;
+            int hole = *i;
+            index.erase(key);
+            if (hole != last)
+            {
+                regs[hole] = regs[last];
+                index.insert(pc_regkey(regs[hole].str), hole);
+            }
+            --*num;
+            return true;
+        }
+        OMATCH_CASE_NONE ()
+        {
+            if (val == 0)
+                return true;
+            if (*num >= max)
+                return false;
+            regs[*num].str = stringish<VarName>(variable_names.outtern(key.base()));
+            regs[*num].value = val;
+            index.insert(key, *num);
+            ++*num;
+            return true;
+        }
     }
+    OMATCH_END ();
+    abort();
+}
 
-    sd->regstrm.insert(reg, str);
+/*==========================================
+ * script用変数の索引を作り直す
+ *------------------------------------------
+ */
+void pc_reindexreg(dumb_ptr<map_session_data> sd)
+{
+    nullpo_retv(sd);
+
+    pc_regindex_build(sd->global_reg_index,
+            &sd->status.global_reg[0], sd->status.global_reg_num);
+    pc_regindex_build(sd->account_reg_index,
+            &sd->status.account_reg[0], sd->status.account_reg_num);
+    pc_regindex_build(sd->account_reg2_index,
+            &sd->status.account_reg2[0], sd->status.account_reg2_num);
 }
 
 /*==========================================
  * script用グローバル変数の値を読む
  *------------------------------------------
  */
-int pc_readglobalreg(dumb_ptr<map_session_data> sd, VarName reg)
+int pc_readglobalreg(dumb_ptr<map_session_data> sd, SIR reg)
 {
-    int i;
-
     nullpo_retz(sd);
 
     assert (sd->status.global_reg_num < GLOBAL_REG_NUM);
-    for (i = 0; i < sd->status.global_reg_num; i++)
-    {
-        if (sd->status.global_reg[i].str == reg)
-            return sd->status.global_reg[i].value;
-    }
+    return pc_regindex_read(sd->global_reg_index, &sd->status.global_reg[0], reg);
+}
 
-    return 0;
+int pc_readglobalreg(dumb_ptr<map_session_data> sd, VarName reg)
+{
+    return pc_readglobalreg(sd, pc_regkey(reg));
 }
 
 /*==========================================
  * script用グローバル変数の値を設定
  *------------------------------------------
  */
-int pc_setglobalreg(dumb_ptr<map_session_data> sd, VarName reg, int val)
+int pc_setglobalreg(dumb_ptr<map_session_data> sd, SIR reg, int val)
 {
-    int i;
-
     nullpo_retz(sd);
 
     //PC_DIE_COUNTERがスクリプトなどで変更された時の処理
-    if (reg == stringish<VarName>("PC_DIE_COUNTER"_s) && sd->die_counter != val)
+    if (sd->die_counter != val
+        && variable_names.outtern(reg.base()) == "PC_DIE_COUNTER"_s)
     {
         sd->die_counter = val;
         pc_calcstatus(sd, 0);
     }
     assert (sd->status.global_reg_num < GLOBAL_REG_NUM);
-    if (val == 0)
-    {
-        for (i = 0; i < sd->status.global_reg_num; i++)
-        {
-            if (sd->status.global_reg[i].str == reg)
-            {
-                sd->status.global_reg[i] =
-                    sd->status.global_reg[sd->status.global_reg_num - 1];
-                sd->status.global_reg_num--;
-                break;
-            }
-        }
-        return 0;
-    }
-    for (i = 0; i < sd->status.global_reg_num; i++)
-    {
-        if (sd->status.global_reg[i].str == reg)
-        {
-            sd->status.global_reg[i].value = val;
-            return 0;
-        }
-    }
-    if (sd->status.global_reg_num < GLOBAL_REG_NUM)
-    {
-        sd->status.global_reg[i].str = reg;
-        sd->status.global_reg[i].value = val;
-        sd->status.global_reg_num++;
+    if (pc_regindex_set(sd->global_reg_index, &sd->status.global_reg[0],
+                &sd->status.global_reg_num, GLOBAL_REG_NUM, reg, val))
         return 0;
-    }
     if (battle_config.error_log)
         PRINTF("pc_setglobalreg : couldn't set %s (GLOBAL_REG_NUM = %d)\n"_fmt,
-                reg, GLOBAL_REG_NUM);
+                variable_names.outtern(reg.base()), GLOBAL_REG_NUM);
 
     return 1;
 }
 
+int pc_setglobalreg(dumb_ptr<map_session_data> sd, VarName reg, int val)
+{
+    return pc_setglobalreg(sd, pc_regkey(reg), val);
+}
+
 /*==========================================
  * script用アカウント変数の値を読む
  *------------------------------------------
  */
-int pc_readaccountreg(dumb_ptr<map_session_data> sd, VarName reg)
+int pc_readaccountreg(dumb_ptr<map_session_data> sd, SIR reg)
 {
-    int i;
-
     nullpo_retz(sd);
 
     assert (sd->status.account_reg_num < ACCOUNT_REG_NUM);
-    for (i = 0; i < sd->status.account_reg_num; i++)
-    {
-        if (sd->status.account_reg[i].str == reg)
-            return sd->status.account_reg[i].value;
-    }
+    return pc_regindex_read(sd->account_reg_index, &sd->status.account_reg[0], reg);
+}
 
-    return 0;
+int pc_readaccountreg(dumb_ptr<map_session_data> sd, VarName reg)
+{
+    return pc_readaccountreg(sd, pc_regkey(reg));
 }
 
 /*==========================================
  * script用アカウント変数の値を設定
  *------------------------------------------
  */
-int pc_setaccountreg(dumb_ptr<map_session_data> sd, VarName reg, int val)
+int pc_setaccountreg(dumb_ptr<map_session_data> sd, SIR reg, int val)
 {
-    int i;
-
     nullpo_retz(sd);
 
-    if (val == 0)
-    {
-        for (i = 0; i < sd->status.account_reg_num; i++)
-        {
-            if (sd->status.account_reg[i].str == reg)
-            {
-                sd->status.account_reg[i] =
-                    sd->status.account_reg[sd->status.account_reg_num - 1];
-                sd->status.account_reg_num--;
-                break;
-            }
-        }
-        intif_saveaccountreg(sd);
-        return 0;
-    }
-    for (i = 0; i < sd->status.account_reg_num; i++)
-    {
-        if (sd->status.account_reg[i].str == reg)
-        {
-            sd->status.account_reg[i].value = val;
-            intif_saveaccountreg(sd);
-            return 0;
-        }
-    }
-    if (sd->status.account_reg_num < ACCOUNT_REG_NUM)
+    if (pc_regindex_set(sd->account_reg_index, &sd->status.account_reg[0],
+                &sd->status.account_reg_num, ACCOUNT_REG_NUM, reg, val))
     {
-        sd->status.account_reg[i].str = reg;
-        sd->status.account_reg[i].value = val;
-        sd->status.account_reg_num++;
         intif_saveaccountreg(sd);
         return 0;
     }
     if (battle_config.error_log)
         PRINTF("pc_setaccountreg : couldn't set %s (ACCOUNT_REG_NUM = %zu)\n"_fmt,
-                reg, ACCOUNT_REG_NUM);
+                variable_names.outtern(reg.base()), ACCOUNT_REG_NUM);
 
     return 1;
 }
 
+int pc_setaccountreg(dumb_ptr<map_session_data> sd, VarName reg, int val)
+{
+    return pc_setaccountreg(sd, pc_regkey(reg), val);
+}
+
 /*==========================================
  * script用アカウント変数2の値を読む
  *------------------------------------------
  */
-int pc_readaccountreg2(dumb_ptr<map_session_data> sd, VarName reg)
+int pc_readaccountreg2(dumb_ptr<map_session_data> sd, SIR reg)
 {
-    int i;
-
     nullpo_retz(sd);
 
-    for (i = 0; i < sd->status.account_reg2_num; i++)
-    {
-        if (sd->status.account_reg2[i].str == reg)
-            return sd->status.account_reg2[i].value;
-    }
+    return pc_regindex_read(sd->account_reg2_index, &sd->status.account_reg2[0], reg);
+}
 
-    return 0;
+int pc_readaccountreg2(dumb_ptr<map_session_data> sd, VarName reg)
+{
+    return pc_readaccountreg2(sd, pc_regkey(reg));
 }
 
 /*==========================================
  * script用アカウント変数2の値を設定
  *------------------------------------------
  */
-int pc_setaccountreg2(dumb_ptr<map_session_data> sd, VarName reg, int val)
+int pc_setaccountreg2(dumb_ptr<map_session_data> sd, SIR reg, int val)
 {
-    int i;
-
     nullpo_retr(1, sd);
 
-    if (val == 0)
-    {
-        for (i = 0; i < sd->status.account_reg2_num; i++)
-        {
-            if (sd->status.account_reg2[i].str == reg)
-            {
-                sd->status.account_reg2[i] =
-                    sd->status.account_reg2[sd->status.account_reg2_num - 1];
-                sd->status.account_reg2_num--;
-                break;
-            }
-        }
-        chrif_saveaccountreg2(sd);
-        return 0;
-    }
-    for (i = 0; i < sd->status.account_reg2_num; i++)
+    if (pc_regindex_set(sd->account_reg2_index, &sd->status.account_reg2[0],
+                &sd->status.account_reg2_num, ACCOUNT_REG2_NUM, reg, val))
     {
-        if (sd->status.account_reg2[i].str == reg)
-        {
-            sd->status.account_reg2[i].value = val;
-            chrif_saveaccountreg2(sd);
-            return 0;
-        }
-    }
-    if (sd->status.account_reg2_num < ACCOUNT_REG2_NUM)
-    {
-        sd->status.account_reg2[i].str = reg;
-        sd->status.account_reg2[i].value = val;
-        sd->status.account_reg2_num++;
         chrif_saveaccountreg2(sd);
         return 0;
     }
     if (battle_config.error_log)
         PRINTF("pc_setaccountreg2 : couldn't set %s (ACCOUNT_REG2_NUM = %zu)\n"_fmt,
-                reg, ACCOUNT_REG2_NUM);
+                variable_names.outtern(reg.base()), ACCOUNT_REG2_NUM);
 
     return 1;
 }
 
+int pc_setaccountreg2(dumb_ptr<map_session_data> sd, VarName reg, int val)
+{
+    return pc_setaccountreg2(sd, pc_regkey(reg), val);
+}
+
 /*==========================================
  * イベントタイマー処理
  *------------------------------------------
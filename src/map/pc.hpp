@@ -147,11 +147,18 @@ int pc_readreg(dumb_ptr<map_session_data>, SIR);
 void pc_setreg(dumb_ptr<map_session_data>, SIR, int);
 ZString pc_readregstr(dumb_ptr<map_session_data> sd, SIR reg);
 void pc_setregstr(dumb_ptr<map_session_data> sd, SIR reg, RString str);
+void pc_reindexreg(dumb_ptr<map_session_data>);
+int pc_readglobalreg(dumb_ptr<map_session_data>, SIR);
 int pc_readglobalreg(dumb_ptr<map_session_data>, VarName );
+int pc_setglobalreg(dumb_ptr<map_session_data>, SIR, int);
 int pc_setglobalreg(dumb_ptr<map_session_data>, VarName , int);
+int pc_readaccountreg(dumb_ptr<map_session_data>, SIR);
 int pc_readaccountreg(dumb_ptr<map_session_data>, VarName );
+int pc_setaccountreg(dumb_ptr<map_session_data>, SIR, int);
 int pc_setaccountreg(dumb_ptr<map_session_data>, VarName , int);
+int pc_readaccountreg2(dumb_ptr<map_session_data>, SIR);
 int pc_readaccountreg2(dumb_ptr<map_session_data>, VarName );
+int pc_setaccountreg2(dumb_ptr<map_session_data>, SIR, int);
 int pc_setaccountreg2(dumb_ptr<map_session_data>, VarName , int);
 
 int pc_addeventtimer(dumb_ptr<map_session_data> sd, interval_t tick,
@@ -0,0 +1,303 @@
+#include "script-cache.hpp"
+//    script-cache.cpp - On-disk cache of compiled scripts.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../strings/astring.hpp"
+#include "../strings/xstring.hpp"
+#include "../strings/literal.hpp"
+
+#include "../generic/db.hpp"
+
+#include "../io/cxxstdio.hpp"
+#include "../io/lock.hpp"
+#include "../io/mmap.hpp"
+#include "../io/read.hpp"
+
+#include "../mmo/version.hpp"
+
+#include "globals.hpp"
+#include "map_conf.hpp"
+#include "script-parse-internal.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+// The cache file holds, for every script body compiled on the last
+// start, the bytecode and labels that compile_script() made of it.
+// Entries are keyed by a hash of the body text, salted with the server
+// binary itself and every builtin, param and constant the parser knows,
+// so any change to those makes every entry miss rather than go stale.
+//
+// The cache is only consulted between script_cache_init(), once all
+// the config (and so const_db) has been read, and script_cache_save();
+// scripts compiled outside that window are just compiled.
+//
+// The format is native-endian and only meant to be read back by the
+// same build on the same machine.
+
+constexpr uint32_t SCRIPT_CACHE_MAGIC = 0x54534331; // "TSC1"
+
+static
+uint64_t fnv1a(uint64_t h, const char *data, size_t len)
+{
+    return strings::fnv1a(h, XString(data, data + len, nullptr));
+}
+
+template<class T>
+static
+uint64_t fnv1a(uint64_t h, T v)
+{
+    return fnv1a(h, reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static
+uint64_t cache_salt(void)
+{
+    uint64_t h = strings::FNV1A_BASIS;
+    h = fnv1a(h, SCRIPT_CACHE_MAGIC);
+    // a rebuild from the same commit may still lay out bytecode
+    // differently, so hash the binary, not just its version
+    io::MappedFile exe("/proc/self/exe"_s);
+    if (exe.is_open())
+        h = fnv1a(h, exe.data(), exe.size());
+    else
+        h = fnv1a(h, VERSION_INFO_COMMIT.data(), VERSION_INFO_COMMIT.size());
+    for (auto& pair : str_datam)
+    {
+        const str_data_t& sd = pair.second;
+        if (sd.type != StringCode::FUNC
+                && sd.type != StringCode::PARAM
+                && sd.type != StringCode::INT)
+            continue;
+        XString name = pair.first;
+        h = fnv1a(h, name.data(), name.size());
+        h = fnv1a(h, sd.type);
+        h = fnv1a(h, sd.val);
+    }
+    return h;
+}
+
+uint64_t script_cache_key(XString body, bool implicit_end)
+{
+    uint64_t h = script_cache_salt;
+    h = fnv1a(h, implicit_end);
+    return fnv1a(h, body.data(), body.size());
+}
+
+template<class T>
+static
+bool cache_get(io::ReadFile& in, T *v)
+{
+    return in.get(reinterpret_cast<char *>(v), sizeof(*v)) == sizeof(*v);
+}
+
+static
+bool cache_get_str(io::ReadFile& in, AString *s)
+{
+    uint32_t len;
+    if (!cache_get(in, &len))
+        return false;
+    std::vector<char> buf(len);
+    if (in.get(buf.data(), len) != len)
+        return false;
+    *s = XString(buf.data(), buf.data() + len, nullptr);
+    return true;
+}
+
+static
+bool script_cache_load_entry(io::ReadFile& in, uint64_t *key, script_cache_entry *entry)
+{
+    uint32_t len;
+    if (!cache_get(in, key) || !cache_get(in, &len))
+        return false;
+    entry->code.resize(len);
+    if (in.get(reinterpret_cast<char *>(entry->code.data()), len) != len)
+        return false;
+
+    if (!cache_get(in, &len))
+        return false;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        AString name;
+        uint32_t pos;
+        if (!cache_get_str(in, &name) || !cache_get(in, &pos))
+            return false;
+        if (name.size() > 23 || pos >= entry->code.size())
+            return false;
+        entry->labels.push_back(std::make_pair(stringish<ScriptLabel>(name), pos));
+    }
+
+    if (!cache_get(in, &len))
+        return false;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        AString name;
+        uint32_t pos;
+        if (!cache_get(in, &pos) || !cache_get_str(in, &name))
+            return false;
+        // the variable id is patched into the 3 bytes at pos
+        if (static_cast<size_t>(pos) + 3 > entry->code.size())
+            return false;
+        entry->variables.push_back(std::make_pair(pos, RString(name)));
+    }
+    entry->used = false;
+    return true;
+}
+
+/*==========================================
+ * Salt and load the cache; must run after every config file,
+ * since const_db and friends feed the salt.
+ *------------------------------------------
+ */
+void script_cache_init(void)
+{
+    if (!map_conf.script_cache)
+        return;
+    // the salt covers the builtins, so they must exist first
+    add_builtin_functions();
+    script_cache_salt = cache_salt();
+    script_cache_ready = true;
+
+    io::ReadFile in(map_conf.script_cache);
+    if (!in.is_open())
+        return;
+
+    uint32_t magic;
+    uint64_t salt;
+    if (!cache_get(in, &magic) || magic != SCRIPT_CACHE_MAGIC
+            || !cache_get(in, &salt) || salt != script_cache_salt)
+    {
+        PRINTF("%s: out of date, ignoring\n"_fmt, map_conf.script_cache);
+        return;
+    }
+
+    uint64_t key;
+    script_cache_entry entry;
+    while (script_cache_load_entry(in, &key, &entry))
+    {
+        script_cache_db.insert(key, std::move(entry));
+        entry = script_cache_entry();
+    }
+}
+
+Option<Borrowed<script_cache_entry>> script_cache_find(uint64_t key)
+{
+    if (!script_cache_ready)
+        return None;
+    Option<Borrowed<script_cache_entry>> rv = script_cache_db.search(key);
+    OMATCH_BEGIN (rv)
+    {
+        OMATCH_CASE_SOME (entry)
+        {
+            entry->used = true;
+            script_cache_hits++;
+        }
+        OMATCH_CASE_NONE ()
+        {
+            script_cache_misses++;
+        }
+    }
+    OMATCH_END ();
+    return rv;
+}
+
+void script_cache_insert(uint64_t key, script_cache_entry entry)
+{
+    if (!script_cache_ready)
+        return;
+    entry.used = true;
+    script_cache_db.insert(key, std::move(entry));
+}
+
+template<class T>
+static
+void cache_put(io::WriteFile& out, T v)
+{
+    out.really_put(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static
+void cache_put_str(io::WriteFile& out, XString s)
+{
+    cache_put<uint32_t>(out, s.size());
+    out.really_put(s.data(), s.size());
+}
+
+// Rewrite the cache with just the scripts used by this start,
+// unless it already held exactly those.
+static
+void script_cache_write(void)
+{
+    PRINTF("Script cache: %d hits, %d misses\n"_fmt,
+            script_cache_hits, script_cache_misses);
+
+    bool stale = script_cache_misses != 0;
+    for (auto& pair : script_cache_db)
+        if (!pair.second.used)
+            stale = true;
+    if (!stale)
+        return;
+
+    io::WriteLock out(map_conf.script_cache);
+    if (!out.is_open())
+        return;
+    cache_put(out, SCRIPT_CACHE_MAGIC);
+    cache_put(out, script_cache_salt);
+    for (auto& pair : script_cache_db)
+    {
+        const script_cache_entry& entry = pair.second;
+        if (!entry.used)
+            continue;
+        cache_put(out, pair.first);
+        cache_put<uint32_t>(out, entry.code.size());
+        out.really_put(reinterpret_cast<const char *>(entry.code.data()), entry.code.size());
+        cache_put<uint32_t>(out, entry.labels.size());
+        for (const auto& label : entry.labels)
+        {
+            cache_put_str(out, label.first);
+            cache_put<uint32_t>(out, label.second);
+        }
+        cache_put<uint32_t>(out, entry.variables.size());
+        for (const auto& var : entry.variables)
+        {
+            cache_put<uint32_t>(out, var.first);
+            cache_put_str(out, var.second);
+        }
+    }
+}
+
+/*==========================================
+ * Write the cache out and drop the in-memory copy;
+ * nothing compiled after this is cached.
+ *------------------------------------------
+ */
+void script_cache_save(void)
+{
+    if (!script_cache_ready)
+        return;
+    script_cache_write();
+    script_cache_db.clear();
+    script_cache_ready = false;
+}
+} // namespace map
+} // namespace tmwa
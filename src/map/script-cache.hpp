@@ -0,0 +1,56 @@
+#pragma once
+//    script-cache.hpp - On-disk cache of compiled scripts.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+#include "../strings/rstring.hpp"
+
+#include "../mmo/strs.hpp"
+
+#include "script-call.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+/// What compile_script() produced for one script body.
+struct script_cache_entry
+{
+    std::vector<ByteCode> code;
+    std::vector<std::pair<ScriptLabel, size_t>> labels;
+    // interned variable ids differ between runs, so these are
+    // stored by name and patched back in on load
+    std::vector<std::pair<size_t, RString>> variables;
+    bool used;
+};
+
+void script_cache_init(void);
+uint64_t script_cache_key(XString body, bool implicit_end);
+Option<Borrowed<script_cache_entry>> script_cache_find(uint64_t key);
+void script_cache_insert(uint64_t key, script_cache_entry entry);
+void script_cache_save(void);
+} // namespace map
+} // namespace tmwa
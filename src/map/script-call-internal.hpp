@@ -38,6 +38,49 @@ enum class VariableCode : uint8_t
     VARIABLE,
 };
 
+/// Where a variable lives, as given by the sigils around its name.
+enum class VariableScope : uint8_t
+{
+    // @name, @name$: per player, not saved
+    TEMP,
+    TEMP_STR,
+    // $name, $name$: server-wide, in mapreg
+    MAP,
+    MAP_STR,
+    // #name: per account
+    ACCOUNT,
+    // ##name: per account, shared between char servers
+    ACCOUNT2,
+    // name: per character
+    CHAR,
+    // #name$, ##name$, name$: not supported
+    ILLEGAL_STR,
+};
+
+inline
+bool variable_is_str(VariableScope scope)
+{
+    return scope == VariableScope::TEMP_STR
+        || scope == VariableScope::MAP_STR
+        || scope == VariableScope::ILLEGAL_STR;
+}
+
+inline
+bool variable_is_shared(VariableScope scope)
+{
+    return scope == VariableScope::MAP
+        || scope == VariableScope::MAP_STR;
+}
+
+// only these have room for an index in the SIR
+inline
+bool variable_is_array(VariableScope scope)
+{
+    return scope == VariableScope::TEMP
+        || scope == VariableScope::TEMP_STR
+        || variable_is_shared(scope);
+}
+
 struct script_stack
 {
     std::vector<struct script_data> stack_datav;
@@ -54,9 +97,21 @@ public:
     BlockId rid, oid;
     ScriptPointer scriptp, new_scriptp;
     int defsp, new_defsp;
+    // how many times it has been put back on script_run_queue
+    int slices;
+};
+
+/// A script that used up its budget, to be resumed on a later tick.
+struct ScriptSlice
+{
+    ScriptState st;
+    struct script_stack stack;
+    Borrowed<const ScriptBuffer> rootscript;
 };
 
 void run_func(ScriptState *st);
+int eval_op_2num(ByteCode op, int i1, int i2);
+int eval_op_1num(ByteCode op, int i1);
 
 enum class ScriptEndState
 {
@@ -66,9 +121,11 @@ enum class ScriptEndState
     RERUNLINE,
     GOTO,
     RETFUNC,
+    YIELD,
 };
 
 dumb_ptr<map_session_data> script_rid2sd(ScriptState *st);
+VariableScope variable_scope(SIR reg);
 void get_val(dumb_ptr<map_session_data> sd, struct script_data *data);
 __attribute__((deprecated))
 void get_val(ScriptState *st, struct script_data *data);
@@ -26,6 +26,8 @@
 
 #include "../io/cxxstdio.hpp"
 
+#include "../net/timer.hpp"
+
 #include "../mmo/cxxstdio_enums.hpp"
 
 #include "battle.hpp"
@@ -37,6 +39,7 @@
 #include "script-fun.hpp"
 #include "script-parse-internal.hpp"
 #include "script-persist.hpp"
+#include "script-profile.hpp"
 #include "script-startup-internal.hpp"
 
 #include "../poison.hpp"
@@ -55,6 +58,9 @@ struct ScriptConfigRun
     int check_cmdcount = 8192;
     static const
     int check_gotocount = 512;
+    // a script is only killed after this many slices of the above
+    static const
+    int check_slicecount = 256;
 } script_config;
 
 
@@ -72,6 +78,50 @@ dumb_ptr<map_session_data> script_rid2sd(ScriptState *st)
     return sd;
 }
 
+static
+VariableScope classify_variable(ZString name)
+{
+    char prefix = name.front();
+    char postfix = name.back();
+
+    if (postfix == '$')
+    {
+        if (prefix == '@')
+            return VariableScope::TEMP_STR;
+        if (prefix == '$')
+            return VariableScope::MAP_STR;
+        return VariableScope::ILLEGAL_STR;
+    }
+    if (prefix == '@')
+        return VariableScope::TEMP;
+    if (prefix == '$')
+        return VariableScope::MAP;
+    if (prefix == '#')
+    {
+        if (name.startswith("##"_s))
+            return VariableScope::ACCOUNT2;
+        return VariableScope::ACCOUNT;
+    }
+    return VariableScope::CHAR;
+}
+
+/*==========================================
+ * 変数のスコープ
+ * Computed once per interned name, so that the accessors below
+ * never have to look at the name itself.
+ *------------------------------------------
+ */
+VariableScope variable_scope(SIR reg)
+{
+    unsigned base = reg.base();
+    if (base >= variable_scopes.size())
+    {
+        for (size_t i = variable_scopes.size(); i < variable_names.size(); ++i)
+            variable_scopes.push_back(classify_variable(variable_names.outtern(i)));
+    }
+    return variable_scopes[base];
+}
+
 /*==========================================
  * 変数の読み取り
  *------------------------------------------
@@ -91,71 +141,74 @@ void get_val(dumb_ptr<map_session_data> sd, struct script_data *data)
         }
         MATCH_CASE (const ScriptDataVariable&, u)
         {
-            ZString name_ = variable_names.outtern(u.reg.base());
-            VarName name = stringish<VarName>(name_);
-            char prefix = name.front();
-            char postfix = name.back();
+            VariableScope scope = variable_scope(u.reg);
 
-            if (prefix != '$')
+            if (!variable_is_shared(scope))
             {
                 if (sd == nullptr)
-                    PRINTF("get_val error name?:%s\n"_fmt, name);
+                    PRINTF("get_val error name?:%s\n"_fmt, variable_names.outtern(u.reg.base()));
             }
-            if (postfix == '$')
+            switch (scope)
             {
-                RString str;
-                if (prefix == '@')
+                case VariableScope::TEMP_STR:
                 {
+                    RString str;
                     if (sd)
                         str = pc_readregstr(sd, u.reg);
+                    *data = ScriptDataStr{str};
+                    break;
                 }
-                else if (prefix == '$')
+                case VariableScope::MAP_STR:
                 {
+                    RString str;
                     Option<P<RString>> s_ = mapregstr_db.search(u.reg);
                     OMATCH_BEGIN_SOME (s, s_)
                     {
                         str = *s;
                     }
                     OMATCH_END ();
+                    *data = ScriptDataStr{str};
+                    break;
                 }
-                else
-                {
+                case VariableScope::ILLEGAL_STR:
                     PRINTF("script: get_val: illegal scope string variable.\n"_fmt);
-                    str = "!!ERROR!!"_s;
-                }
-                *data = ScriptDataStr{str};
-            }
-            else
-            {
-                int numi = 0;
-                if (prefix == '@')
+                    *data = ScriptDataStr{"!!ERROR!!"_s};
+                    break;
+                case VariableScope::TEMP:
                 {
+                    int numi = 0;
                     if (sd)
                         numi = pc_readreg(sd, u.reg);
+                    *data = ScriptDataInt{numi};
+                    break;
                 }
-                else if (prefix == '$')
+                case VariableScope::MAP:
+                    *data = ScriptDataInt{mapreg_db.get(u.reg)};
+                    break;
+                case VariableScope::ACCOUNT:
                 {
-                    numi = mapreg_db.get(u.reg);
+                    int numi = 0;
+                    if (sd)
+                        numi = pc_readaccountreg(sd, u.reg);
+                    *data = ScriptDataInt{numi};
+                    break;
                 }
-                else if (prefix == '#')
+                case VariableScope::ACCOUNT2:
                 {
-                    if (name[1] == '#')
-                    {
-                        if (sd)
-                            numi = pc_readaccountreg2(sd, name);
-                    }
-                    else
-                    {
-                        if (sd)
-                            numi = pc_readaccountreg(sd, name);
-                    }
+                    int numi = 0;
+                    if (sd)
+                        numi = pc_readaccountreg2(sd, u.reg);
+                    *data = ScriptDataInt{numi};
+                    break;
                 }
-                else
+                case VariableScope::CHAR:
                 {
+                    int numi = 0;
                     if (sd)
-                        numi = pc_readglobalreg(sd, name);
+                        numi = pc_readglobalreg(sd, u.reg);
+                    *data = ScriptDataInt{numi};
+                    break;
                 }
-                *data = ScriptDataInt{numi};
             }
         }
     }
@@ -193,49 +246,32 @@ void set_reg(dumb_ptr<map_session_data> sd, VariableCode type, SIR reg, struct s
     }
     assert (type == VariableCode::VARIABLE);
 
-    ZString name_ = variable_names.outtern(reg.base());
-    VarName name = stringish<VarName>(name_);
-    char prefix = name.front();
-    char postfix = name.back();
-
-    if (postfix == '$')
+    switch (variable_scope(reg))
     {
-        RString str = vd.get_if<ScriptDataStr>()->str;
-        if (prefix == '@')
-        {
-            pc_setregstr(sd, reg, str);
-        }
-        else if (prefix == '$')
-        {
-            mapreg_setregstr(reg, str);
-        }
-        else
-        {
+        case VariableScope::TEMP_STR:
+            pc_setregstr(sd, reg, vd.get_if<ScriptDataStr>()->str);
+            break;
+        case VariableScope::MAP_STR:
+            mapreg_setregstr(reg, vd.get_if<ScriptDataStr>()->str);
+            break;
+        case VariableScope::ILLEGAL_STR:
             PRINTF("script: set_reg: illegal scope string variable !"_fmt);
-        }
-    }
-    else
-    {
-        int val = vd.get_if<ScriptDataInt>()->numi;
-        if (prefix == '@')
-        {
-            pc_setreg(sd, reg, val);
-        }
-        else if (prefix == '$')
-        {
-            mapreg_setreg(reg, val);
-        }
-        else if (prefix == '#')
-        {
-            if (name[1] == '#')
-                pc_setaccountreg2(sd, name, val);
-            else
-                pc_setaccountreg(sd, name, val);
-        }
-        else
-        {
-            pc_setglobalreg(sd, name, val);
-        }
+            break;
+        case VariableScope::TEMP:
+            pc_setreg(sd, reg, vd.get_if<ScriptDataInt>()->numi);
+            break;
+        case VariableScope::MAP:
+            mapreg_setreg(reg, vd.get_if<ScriptDataInt>()->numi);
+            break;
+        case VariableScope::ACCOUNT:
+            pc_setaccountreg(sd, reg, vd.get_if<ScriptDataInt>()->numi);
+            break;
+        case VariableScope::ACCOUNT2:
+            pc_setaccountreg2(sd, reg, vd.get_if<ScriptDataInt>()->numi);
+            break;
+        case VariableScope::CHAR:
+            pc_setglobalreg(sd, reg, vd.get_if<ScriptDataInt>()->numi);
+            break;
     }
 }
 
@@ -324,17 +360,21 @@ void pop_stack(struct script_stack *stack, int start, int end)
 //
 /*==========================================
  * コマンドの読み取り
+ * run_script_main() decodes straight out of the buffer, instead of
+ * going through ScriptPointer::pop() (and its Option check) per byte.
  *------------------------------------------
  */
 static
-ByteCode get_com(ScriptPointer *script)
+ByteCode get_com(const ByteCode **ip)
 {
-    if (static_cast<uint8_t>(script->peek()) >= 0x80)
+    ByteCode c = **ip;
+    if (static_cast<uint8_t>(c) >= 0x80)
     {
         // synthetic! Does not advance pos yet.
         return ByteCode::INT;
     }
-    return script->pop();
+    ++*ip;
+    return c;
 }
 
 /*==========================================
@@ -342,14 +382,14 @@ ByteCode get_com(ScriptPointer *script)
  *------------------------------------------
  */
 static
-int get_num(ScriptPointer *scr)
+int get_num(const ByteCode **ip)
 {
     int i = 0;
     int j = 0;
     uint8_t val;
     do
     {
-        val = static_cast<uint8_t>(scr->pop());
+        val = static_cast<uint8_t>(*(*ip)++);
         i += (val & 0x7f) << j;
         j += 6;
     }
@@ -357,6 +397,16 @@ int get_num(ScriptPointer *scr)
     return i;
 }
 
+static
+int get_arg(const ByteCode **ip)
+{
+    const ByteCode *p = *ip;
+    *ip += 3;
+    return static_cast<uint8_t>(p[0]) << 0
+        | static_cast<uint8_t>(p[1]) << 8
+        | static_cast<uint8_t>(p[2]) << 16;
+}
+
 /*==========================================
  * スタックから値を取り出す
  *------------------------------------------
@@ -389,7 +439,7 @@ static
 void op_add(ScriptState *st)
 {
     get_val(st, &st->stack->stack_datav.back());
-    script_data back = st->stack->stack_datav.back();
+    script_data back = std::move(st->stack->stack_datav.back());
     st->stack->stack_datav.pop_back();
 
     script_data& back1 = st->stack->stack_datav.back();
@@ -449,13 +499,17 @@ void op_2str(ScriptState *st, ByteCode op, ZString s1, ZString s2)
 
 /*==========================================
  * 二項演算子(数値)
+ * Also used by the parser to fold constant subexpressions,
+ * so that both give exactly the same answer.
  *------------------------------------------
  */
-static
-void op_2num(ScriptState *st, ByteCode op, int i1, int i2)
+int eval_op_2num(ByteCode op, int i1, int i2)
 {
     switch (op)
     {
+        case ByteCode::ADD:
+            i1 += i2;
+            break;
         case ByteCode::SUB:
             i1 -= i2;
             break;
@@ -508,7 +562,13 @@ void op_2num(ScriptState *st, ByteCode op, int i1, int i2)
             i1 = i1 << i2;
             break;
     }
-    push_int<ScriptDataInt>(st->stack, i1);
+    return i1;
+}
+
+static
+void op_2num(ScriptState *st, ByteCode op, int i1, int i2)
+{
+    push_int<ScriptDataInt>(st->stack, eval_op_2num(op, i1, i2));
 }
 
 /*==========================================
@@ -519,10 +579,10 @@ static
 void op_2(ScriptState *st, ByteCode op)
 {
     // pop_val has unfortunate implications here
-    script_data d2 = st->stack->stack_datav.back();
+    script_data d2 = std::move(st->stack->stack_datav.back());
     st->stack->stack_datav.pop_back();
     get_val(st, &d2);
-    script_data d1 = st->stack->stack_datav.back();
+    script_data d1 = std::move(st->stack->stack_datav.back());
     st->stack->stack_datav.pop_back();
     get_val(st, &d1);
 
@@ -548,11 +608,8 @@ void op_2(ScriptState *st, ByteCode op)
  * 単項演算子
  *------------------------------------------
  */
-static
-void op_1num(ScriptState *st, ByteCode op)
+int eval_op_1num(ByteCode op, int i1)
 {
-    int i1;
-    i1 = pop_val(st);
     switch (op)
     {
         case ByteCode::NEG:
@@ -565,7 +622,14 @@ void op_1num(ScriptState *st, ByteCode op)
             i1 = !i1;
             break;
     }
-    push_int<ScriptDataInt>(st->stack, i1);
+    return i1;
+}
+
+static
+void op_1num(ScriptState *st, ByteCode op)
+{
+    int i1 = pop_val(st);
+    push_int<ScriptDataInt>(st->stack, eval_op_1num(op, i1));
 }
 
 /*==========================================
@@ -650,7 +714,14 @@ void run_func(ScriptState *st)
         }
         PRINTF("\n"_fmt);
     }
-    builtin_functions[func].func(st);
+    if (script_profiling)
+    {
+        profile_clock::time_point start = profile_clock::now();
+        builtin_functions[func].func(st);
+        script_profile_builtin(func, profile_clock::now() - start);
+    }
+    else
+        builtin_functions[func].func(st);
 
     pop_stack(st->stack, start_sp, end_sp);
 
@@ -681,6 +752,83 @@ void run_func(ScriptState *st)
     }
 }
 
+static
+void script_profile_charge(Option<Borrowed<script_profile>> *profile,
+        profile_clock::time_point *start, long *start_insns, long insns)
+{
+    Borrowed<script_profile> p = TRY_UNWRAP(*profile, return);
+    profile_clock::time_point now = profile_clock::now();
+    p->entries++;
+    p->instructions += insns - *start_insns;
+    p->elapsed += now - *start;
+    *start = now;
+    *start_insns = insns;
+}
+
+/*==========================================
+ * Whether a script may be suspended and resumed on a later tick.
+ * Only those that nobody is waiting on qualify: a script attached
+ * to a player keeps its state in the player's npc dialog.
+ *------------------------------------------
+ */
+static
+bool script_slice_valid(BlockId oid, Borrowed<const ScriptBuffer> rootscript)
+{
+    dumb_ptr<block_list> bl = map_id2bl(oid);
+    if (bl == nullptr || bl->bl_type != BL::NPC)
+        return false;
+    dumb_ptr<npc_data> nd = bl->is_npc();
+    if (nd->npc_subtype != NpcSubtype::SCRIPT)
+        return false;
+    return nd->is_script()->scr.script.get() == &*rootscript;
+}
+
+static
+bool script_can_yield(ScriptState *st, Borrowed<const ScriptBuffer> rootscript)
+{
+    if (st->slices >= script_config.check_slicecount)
+        return false;
+    if (map_id2sd(st->rid))
+        return false;
+    return script_slice_valid(st->oid, rootscript);
+}
+
+static
+void run_script_main(ScriptState *st, Borrowed<const ScriptBuffer> rootscript);
+
+// The command or goto budget is spent. Called only where nothing of
+// the current statement is left on the stack, so it can resume at pos.
+static
+void script_budget_spent(ScriptState *st, Borrowed<const ScriptBuffer> rootscript, int pos)
+{
+    if (script_can_yield(st, rootscript))
+    {
+        st->scriptp.pos = pos;
+        st->state = ScriptEndState::YIELD;
+    }
+    else
+    {
+        PRINTF("run_script: infinity loop !\n"_fmt);
+        st->state = ScriptEndState::END;
+    }
+}
+
+static
+void script_run_slices(TimerData *, tick_t)
+{
+    // scripts that yield again go to the next pass
+    std::vector<ScriptSlice> batch;
+    std::swap(batch, script_run_queue);
+
+    for (ScriptSlice& slice : batch)
+    {
+        if (!script_slice_valid(slice.st.oid, slice.rootscript))
+            continue;
+        slice.st.stack = &slice.stack;
+        run_script_main(&slice.st, slice.rootscript);
+    }
+}
+
 /*==========================================
  * スクリプトの実行メイン部分
  *------------------------------------------
@@ -691,14 +839,28 @@ void run_script_main(ScriptState *st, Borrowed<const ScriptBuffer> rootscript)
     int cmdcount = script_config.check_cmdcount;
     int gotocount = script_config.check_gotocount;
     struct script_stack *stack = st->stack;
+    bool out_of_budget = false;
 
-    st->defsp = stack->stack_datav.size();
+    // a resumed slice continues inside whatever function it was in
+    if (!st->slices)
+        st->defsp = stack->stack_datav.size();
 
     int rerun_pos = st->scriptp.pos;
     st->state = ScriptEndState::ZERO;
+    const ByteCode *base = ScriptPointer(TRY_UNWRAP(st->scriptp.code, abort()), 0).ptr();
+    const ByteCode *ip = st->scriptp.ptr();
+
+    Option<Borrowed<script_profile>> profile = None;
+    profile_clock::time_point profile_start;
+    long insns = 0, profile_insns = 0;
+    if (script_profiling)
+    {
+        profile = Some(script_profile_for(TRY_UNWRAP(st->scriptp.code, abort()), st->scriptp.pos));
+        profile_start = profile_clock::now();
+    }
     while (st->state == ScriptEndState::ZERO)
     {
-        switch (ByteCode c = get_com(&st->scriptp))
+        switch (ByteCode c = get_com(&ip))
         {
             case ByteCode::EOL:
                 if (stack->stack_datav.size() != st->defsp)
@@ -709,58 +871,67 @@ void run_script_main(ScriptState *st, Borrowed<const ScriptBuffer> rootscript)
                                 st->defsp);
                     abort();
                 }
-                rerun_pos = st->scriptp.pos;
+                rerun_pos = ip - base;
+                if (out_of_budget)
+                    script_budget_spent(st, rootscript, rerun_pos);
                 break;
             case ByteCode::INT:
                 // synthesized!
-                push_int<ScriptDataInt>(stack, get_num(&st->scriptp));
+                push_int<ScriptDataInt>(stack, get_num(&ip));
                 break;
 
             case ByteCode::POS:
+                push_int<ScriptDataPos>(stack, get_arg(&ip));
+                break;
             case ByteCode::VARIABLE:
+                push_reg<ScriptDataVariable>(stack, SIR::from(get_arg(&ip)));
+                break;
             case ByteCode::FUNC_REF:
+                push_int<ScriptDataFuncRef>(stack, get_arg(&ip));
+                break;
             case ByteCode::PARAM:
-                // Note that these 3 have *very* different meanings,
-                // despite being encoded similarly.
             {
-                int arg = 0;
-                arg |= static_cast<uint8_t>(st->scriptp.pop()) << 0;
-                arg |= static_cast<uint8_t>(st->scriptp.pop()) << 8;
-                arg |= static_cast<uint8_t>(st->scriptp.pop()) << 16;
-                switch(c)
-                {
-                case ByteCode::POS:
-                    push_int<ScriptDataPos>(stack, arg);
-                    break;
-                case ByteCode::VARIABLE:
-                    push_reg<ScriptDataVariable>(stack, SIR::from(arg));
-                    break;
-                case ByteCode::FUNC_REF:
-                    push_int<ScriptDataFuncRef>(stack, arg);
-                    break;
-                case ByteCode::PARAM:
-                    SP arg_sp = static_cast<SP>(arg);
-                    push_reg<ScriptDataParam>(stack, SIR::from(arg_sp));
-                    break;
-                }
+                SP arg_sp = static_cast<SP>(get_arg(&ip));
+                push_reg<ScriptDataParam>(stack, SIR::from(arg_sp));
             }
                 break;
             case ByteCode::ARG:
                 push_int<ScriptDataArg>(stack, 0);
                 break;
             case ByteCode::STR:
-                push_str<ScriptDataStr>(stack, st->scriptp.pops());
+            {
+                ZString str(strings::really_construct_from_a_pointer,
+                        reinterpret_cast<const char *>(ip), nullptr);
+                ip += str.size() + 1;
+                push_str<ScriptDataStr>(stack, str);
+            }
                 break;
             case ByteCode::FUNC:
+                // builtins may look at or change where we are
+                st->scriptp.pos = ip - base;
                 run_func(st);
                 if (st->state == ScriptEndState::GOTO)
                 {
                     rerun_pos = st->scriptp.pos;
                     st->state = ScriptEndState::ZERO;
                     if (gotocount > 0 && (--gotocount) <= 0)
+                        out_of_budget = true;
+                    // a loop of bare gotos never reaches an EOL; a goto
+                    // leaves the stack clear, but a return mid-expression
+                    // does not, and that waits for the EOL instead
+                    if (out_of_budget && stack->stack_datav.size() == st->defsp)
+                        script_budget_spent(st, rootscript, rerun_pos);
+                }
+                if (st->state == ScriptEndState::ZERO)
+                {
+                    const ByteCode *old_base = base;
+                    base = ScriptPointer(TRY_UNWRAP(st->scriptp.code, abort()), 0).ptr();
+                    ip = st->scriptp.ptr();
+                    // callfunc, or return from one
+                    if (base != old_base && profile.is_some())
                     {
-                        PRINTF("run_script: infinity loop !\n"_fmt);
-                        st->state = ScriptEndState::END;
+                        script_profile_charge(&profile, &profile_start, &profile_insns, insns);
+                        profile = Some(script_profile_for(TRY_UNWRAP(st->scriptp.code, abort()), st->scriptp.pos));
                     }
                 }
                 break;
@@ -802,16 +973,17 @@ void run_script_main(ScriptState *st, Borrowed<const ScriptBuffer> rootscript)
             default:
                 if (battle_config.error_log)
                     PRINTF("unknown command : %d @ %zu\n"_fmt,
-                            c, st->scriptp.pos);
+                            c, static_cast<size_t>(ip - base));
                 st->state = ScriptEndState::END;
                 break;
         }
+        insns++;
         if (cmdcount > 0 && (--cmdcount) <= 0)
-        {
-            PRINTF("run_script: infinity loop !\n"_fmt);
-            st->state = ScriptEndState::END;
-        }
+            out_of_budget = true;
     }
+    if (profile.is_some())
+        script_profile_charge(&profile, &profile_start, &profile_insns, insns);
+
     switch (st->state)
     {
         case ScriptEndState::STOP:
@@ -828,9 +1000,18 @@ void run_script_main(ScriptState *st, Borrowed<const ScriptBuffer> rootscript)
         case ScriptEndState::RERUNLINE:
             st->scriptp.pos = rerun_pos;
             break;
+        case ScriptEndState::YIELD:
+            st->slices++;
+            script_run_queue.push_back(ScriptSlice{*st, std::move(*stack), rootscript});
+            if (!script_run_timer)
+                script_run_timer = Timer(gettick() + 1_ms, script_run_slices);
+            // as far as the caller knows, it is finished
+            st->scriptp.code = None;
+            st->scriptp.pos = -1;
+            break;
     }
 
-    if (st->state != ScriptEndState::END)
+    if (st->state != ScriptEndState::END && st->state != ScriptEndState::YIELD)
     {
         // 再開するためにスタック情報を保存
         dumb_ptr<map_session_data> sd = map_id2sd(st->rid);
@@ -874,6 +1055,7 @@ int run_script_l(ScriptPointer sp, BlockId rid, BlockId oid,
     st.scriptp = sp;
     st.rid = rid;
     st.oid = oid;
+    st.slices = 0;
     for (i = 0; i < args.size(); i++)
     {
         if (args[i].name.back() == '$')
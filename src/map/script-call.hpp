@@ -53,6 +53,8 @@ struct ScriptPointer
     ByteCode peek() const;
     ByteCode pop();
     ZString pops();
+    // for run_script_main(), which decodes without going through pop()
+    const ByteCode *ptr() const;
 };
 
 int run_script_l(ScriptPointer, BlockId, BlockId, Slice<argrec_t> args);
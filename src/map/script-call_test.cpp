@@ -0,0 +1,60 @@
+#include "script-call.hpp"
+//    script-call_test.cpp - Testsuite for running scripts
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+
+#include "../strings/rstring.hpp"
+#include "../strings/literal.hpp"
+
+#include "../mmo/ids.hpp"
+
+#include "../ast/script.hpp"
+
+#include "script-parse.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+static
+std::unique_ptr<const ScriptBuffer> compile(RString text)
+{
+    ast::script::ScriptBody body;
+    body.braced_body = text;
+    return compile_script("test"_s, body, false);
+}
+
+// These never reach the end of a statement, so only the goto
+// budget can stop them.
+TEST(script, gotoloop)
+{
+    std::unique_ptr<const ScriptBuffer> bare = compile("{\n    goto L_Loop;\nL_Loop:\n    goto L_Loop;\n}"_s);
+    ASSERT_TRUE(bare);
+    EXPECT_EQ(-1, run_script(ScriptPointer(borrow(*bare), 0), BlockId(), BlockId()));
+
+    std::unique_ptr<const ScriptBuffer> cond = compile("{\n    goto L_Loop;\nL_Loop:\n    if (1) goto L_Loop;\n    end;\n}"_s);
+    ASSERT_TRUE(cond);
+    EXPECT_EQ(-1, run_script(ScriptPointer(borrow(*cond), 0), BlockId(), BlockId()));
+}
+} // namespace map
+} // namespace tmwa
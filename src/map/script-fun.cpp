@@ -22,6 +22,8 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+
 #include "../compat/fun.hpp"
 
 #include "../generic/db.hpp"
@@ -56,6 +58,7 @@
 #include "script-call-internal.hpp"
 #include "script-parse-internal.hpp"
 #include "script-persist.hpp"
+#include "script-startup-internal.hpp"
 #include "skill.hpp"
 #include "storage.hpp"
 
@@ -448,16 +451,14 @@ void builtin_input(ScriptState *st)
     assert (scrd.is<ScriptDataVariable>());
 
     SIR reg = scrd.get_if<ScriptDataVariable>()->reg;
-    ZString name = variable_names.outtern(reg.base());
-//  char prefix = name.front();
-    char postfix = name.back();
+    bool is_str = variable_is_str(variable_scope(reg));
 
     sd = script_rid2sd(st);
     if (sd->state.menu_or_input)
     {
         // Second time (rerun)
         sd->state.menu_or_input = 0;
-        if (postfix == '$')
+        if (is_str)
         {
             set_reg(sd, VariableCode::VARIABLE, reg, sd->npc_str);
         }
@@ -479,7 +480,7 @@ void builtin_input(ScriptState *st)
     {
         // First time - send prompt to client, then wait
         st->state = ScriptEndState::RERUNLINE;
-        if (postfix == '$')
+        if (is_str)
             clif_scriptinputstr(sd, st->oid);
         else
             clif_scriptinput(sd, st->oid);
@@ -531,15 +532,12 @@ void builtin_set(ScriptState *st)
     }
 
     SIR reg = AARG(0).get_if<ScriptDataVariable>()->reg;
+    VariableScope scope = variable_scope(reg);
 
-    ZString name = variable_names.outtern(reg.base());
-    char prefix = name.front();
-    char postfix = name.back();
-
-    if (prefix != '$')
+    if (!variable_is_shared(scope))
         sd = script_rid2sd(st);
 
-    if (postfix == '$')
+    if (variable_is_str(scope))
     {
         // 文字列
         RString str = conv_str(st, &AARG(1));
@@ -563,27 +561,72 @@ void builtin_setarray(ScriptState *st)
 {
     dumb_ptr<map_session_data> sd = nullptr;
     SIR reg = AARG(0).get_if<ScriptDataVariable>()->reg;
-    ZString name = variable_names.outtern(reg.base());
-    char prefix = name.front();
-    char postfix = name.back();
+    VariableScope scope = variable_scope(reg);
 
-    if (prefix != '$' && prefix != '@')
+    if (!variable_is_array(scope))
     {
         PRINTF("builtin_setarray: illegal scope !\n"_fmt);
         return;
     }
-    if (prefix != '$')
+    if (!variable_is_shared(scope))
         sd = script_rid2sd(st);
 
     for (int j = 0, i = 1; i < st->end - st->start - 2 && j < 256; i++, j++)
     {
-        if (postfix == '$')
+        if (variable_is_str(scope))
             set_reg(sd, VariableCode::VARIABLE, reg.iplus(j), conv_str(st, &AARG(i)));
         else
             set_reg(sd, VariableCode::VARIABLE, reg.iplus(j), conv_num(st, &AARG(i)));
     }
 }
 
+/*==========================================
+ * Bulk clear for cleararray, when the value is empty and the
+ * variables are ones with dense storage.
+ *------------------------------------------
+ */
+static
+bool script_clear_array(dumb_ptr<map_session_data> sd, VariableScope scope,
+        SIR reg, int sz, struct script_data *value)
+{
+    if (value->is<ScriptDataVariable>() || value->is<ScriptDataParam>())
+        return false;
+    if (variable_is_str(scope))
+    {
+        auto *u = value->get_if<ScriptDataStr>();
+        if (!u || u->str)
+            return false;
+    }
+    else
+    {
+        auto *u = value->get_if<ScriptDataInt>();
+        if (!u || u->numi)
+            return false;
+    }
+
+    switch (scope)
+    {
+        case VariableScope::TEMP:
+            if (!sd)
+                return false;
+            sd->regm.clear_array(reg, sz);
+            return true;
+        case VariableScope::TEMP_STR:
+            if (!sd)
+                return false;
+            sd->regstrm.clear_array(reg, sz);
+            return true;
+        case VariableScope::MAP:
+            mapreg_clearreg(reg, sz);
+            return true;
+        case VariableScope::MAP_STR:
+            mapreg_clearregstr(reg, sz);
+            return true;
+        default:
+            return false;
+    }
+}
+
 /*==========================================
  * 配列変数クリア
  *------------------------------------------
@@ -593,22 +636,23 @@ void builtin_cleararray(ScriptState *st)
 {
     dumb_ptr<map_session_data> sd = nullptr;
     SIR reg = AARG(0).get_if<ScriptDataVariable>()->reg;
-    ZString name = variable_names.outtern(reg.base());
-    char prefix = name.front();
-    char postfix = name.back();
+    VariableScope scope = variable_scope(reg);
     int sz = conv_num(st, &AARG(2));
 
-    if (prefix != '$' && prefix != '@')
+    if (!variable_is_array(scope))
     {
         PRINTF("builtin_cleararray: illegal scope !\n"_fmt);
         return;
     }
-    if (prefix != '$')
+    if (!variable_is_shared(scope))
         sd = script_rid2sd(st);
 
+    if (sz > 0 && script_clear_array(sd, scope, reg, sz, &AARG(1)))
+        return;
+
     for (int i = 0; i < sz; i++)
     {
-        if (postfix == '$')
+        if (variable_is_str(scope))
             set_reg(sd, VariableCode::VARIABLE, reg.iplus(i), conv_str(st, &AARG(1)));
         else
             set_reg(sd, VariableCode::VARIABLE, reg.iplus(i), conv_num(st, &AARG(1)));
@@ -624,6 +668,26 @@ static
 int getarraysize(ScriptState *st, SIR reg)
 {
     int i = reg.index(), c = i;
+    // temporaries and map variables know their own size
+    switch (variable_scope(reg))
+    {
+        case VariableScope::TEMP:
+        case VariableScope::TEMP_STR:
+        {
+            dumb_ptr<map_session_data> sd = map_id2sd(st->rid);
+            if (!sd)
+                break;
+            size_t n = variable_is_str(variable_scope(reg))
+                ? sd->regstrm.array_size(reg) : sd->regm.array_size(reg);
+            return std::max<int>(c + 1, n);
+        }
+        case VariableScope::MAP:
+            return std::max<int>(c + 1, mapreg_db.array_size(reg));
+        case VariableScope::MAP_STR:
+            return std::max<int>(c + 1, mapregstr_db.array_size(reg));
+        default:
+            break;
+    }
     for (; i < 256; i++)
     {
         struct script_data vd = get_val2(st, reg.iplus(i));
@@ -652,10 +716,9 @@ static
 void builtin_getarraysize(ScriptState *st)
 {
     SIR reg = AARG(0).get_if<ScriptDataVariable>()->reg;
-    ZString name = variable_names.outtern(reg.base());
-    char prefix = name.front();
+    VariableScope scope = variable_scope(reg);
 
-    if (prefix != '$' && prefix != '@')
+    if (!variable_is_array(scope))
     {
         PRINTF("builtin_copyarray: illegal scope !\n"_fmt);
         return;
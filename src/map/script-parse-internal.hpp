@@ -63,5 +63,6 @@ struct str_data_t
 
 Option<Borrowed<str_data_t>> search_strp(XString p);
 Borrowed<str_data_t> add_strp(XString p);
+void add_builtin_functions(void);
 } // namespace map
 } // namespace tmwa
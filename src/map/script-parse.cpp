@@ -38,7 +38,10 @@
 
 #include "globals.hpp"
 #include "map.t.hpp"
+#include "map_conf.hpp"
 #include "script-buffer.hpp"
+#include "script-cache.hpp"
+#include "script-call-internal.hpp"
 #include "script-call.hpp"
 #include "script-fun.hpp"
 
@@ -67,6 +70,11 @@ public:
     void add_scripti(uint32_t a);
     void add_scriptl(Borrowed<str_data_t> a);
     void set_label(Borrowed<str_data_t> ld, int pos_);
+    bool read_int(size_t begin, size_t end, int *out) const;
+    bool fold_op_1(size_t operand, ByteCode op);
+    bool fold_op_2(size_t lhs, size_t rhs, ByteCode op);
+    bool read_goto(size_t pos_, size_t *target) const;
+    void thread_jumps();
     ZSit parse_simpleexpr(ZSit p);
     ZSit parse_subexpr(ZSit p, int limit);
     ZSit parse_expr(ZSit p);
@@ -75,10 +83,19 @@ public:
 
     // consumption methods
     ByteCode operator[](size_t i) const { return script_buf[i]; }
+    const ByteCode *ptr(size_t i) const { return &script_buf[i]; }
     ZString get_str(size_t i) const
     {
         return ZString(strings::really_construct_from_a_pointer, reinterpret_cast<const char *>(&script_buf[i]), nullptr);
     }
+
+    // for script-cache
+    script_cache_entry to_cache() const;
+    void from_cache(const script_cache_entry& entry);
+
+    // for diagnostics
+    RString get_debug_name() const { return debug_name; }
+    ScriptLabel get_debug_label(size_t pos_) const;
 };
 } // namespace map
 } // namespace tmwa
@@ -92,9 +109,33 @@ namespace tmwa
 {
 namespace map
 {
+ScriptLabel ScriptBuffer::get_debug_label(size_t pos_) const
+{
+    // labels are recorded in order of position
+    ScriptLabel rv = stringish<ScriptLabel>("(start)"_s);
+    for (const auto& pair : debug_labels)
+    {
+        if (pair.second > pos_)
+            break;
+        rv = pair.first;
+    }
+    return rv;
+}
+
+RString script_debug_name(Borrowed<const ScriptBuffer> code)
+{
+    return code->get_debug_name();
+}
+
+ScriptLabel script_debug_label(Borrowed<const ScriptBuffer> code, size_t pos)
+{
+    return code->get_debug_label(pos);
+}
+
 // implemented for script-call.hpp because reasons
 ByteCode ScriptPointer::peek() const { return (*TRY_UNWRAP(code, abort()))[pos]; }
 ByteCode ScriptPointer::pop() { return (*TRY_UNWRAP(code, abort()))[pos++]; }
+const ByteCode *ScriptPointer::ptr() const { return TRY_UNWRAP(code, abort())->ptr(pos); }
 ZString ScriptPointer::pops()
 {
     ZString rv = TRY_UNWRAP(code, abort())->get_str(pos);
@@ -241,6 +282,179 @@ void ScriptBuffer::set_label(Borrowed<str_data_t> ld, int pos_)
     }
 }
 
+/*==========================================
+ * 定数の畳み込み
+ * If [begin, end) is exactly one integer literal, decode it.
+ *------------------------------------------
+ */
+bool ScriptBuffer::read_int(size_t begin, size_t end, int *out) const
+{
+    int i = 0;
+    int j = 0;
+    size_t pos_ = begin;
+    uint8_t val;
+    if (pos_ == end || static_cast<uint8_t>(script_buf[pos_]) < 0x80)
+        return false;
+    do
+    {
+        if (pos_ == end)
+            return false;
+        val = static_cast<uint8_t>(script_buf[pos_++]);
+        i += (val & 0x7f) << j;
+        j += 6;
+    }
+    while (val >= 0xc0);
+    if (pos_ != end)
+        return false;
+    *out = i;
+    return true;
+}
+
+// How many bytes add_scripti(a) writes.
+static
+size_t scripti_size(uint32_t a)
+{
+    size_t n = 1;
+    while (a >= 0x40)
+    {
+        n++;
+        a = (a - 0x40) >> 6;
+    }
+    return n;
+}
+
+bool ScriptBuffer::fold_op_1(size_t operand, ByteCode op)
+{
+    int i1;
+    if (!read_int(operand, script_buf.size(), &i1))
+        return false;
+    int rv = eval_op_1num(op, i1);
+    // the operands and the operator, which hasn't been added yet
+    size_t old_size = script_buf.size() - operand + 1;
+    // e.g. -1 takes more bytes than 1 and the operator
+    size_t new_size = scripti_size(rv);
+    if (new_size > old_size)
+        return false;
+    script_buf.resize(operand);
+    add_scripti(rv);
+    script_folded++;
+    script_folded_bytes += old_size - new_size;
+    return true;
+}
+
+bool ScriptBuffer::fold_op_2(size_t lhs, size_t rhs, ByteCode op)
+{
+    int i1, i2;
+    if (op == ByteCode::FUNC)
+        return false;
+    if (!read_int(lhs, rhs, &i1) || !read_int(rhs, script_buf.size(), &i2))
+        return false;
+    // leave the crash for runtime, where it will at least be reported
+    // against the right npc
+    if ((op == ByteCode::DIV || op == ByteCode::MOD) && i2 == 0)
+        return false;
+    int rv = eval_op_2num(op, i1, i2);
+    size_t old_size = script_buf.size() - lhs + 1;
+    size_t new_size = scripti_size(rv);
+    if (new_size > old_size)
+        return false;
+    script_buf.resize(lhs);
+    add_scripti(rv);
+    script_folded++;
+    script_folded_bytes += old_size - new_size;
+    return true;
+}
+
+/*==========================================
+ * ジャンプの短絡
+ * A line consisting of only "goto L;" is
+ *   FUNC_REF goto, ARG, POS L, FUNC, EOL
+ *------------------------------------------
+ */
+bool ScriptBuffer::read_goto(size_t pos_, size_t *target) const
+{
+    if (pos_ + 11 > script_buf.size())
+        return false;
+    if (script_buf[pos_] != ByteCode::FUNC_REF
+        || script_buf[pos_ + 4] != ByteCode::ARG
+        || script_buf[pos_ + 5] != ByteCode::POS
+        || script_buf[pos_ + 9] != ByteCode::FUNC
+        || script_buf[pos_ + 10] != ByteCode::EOL)
+        return false;
+    int func = 0;
+    func |= static_cast<uint8_t>(script_buf[pos_ + 1]) << 0;
+    func |= static_cast<uint8_t>(script_buf[pos_ + 2]) << 8;
+    func |= static_cast<uint8_t>(script_buf[pos_ + 3]) << 16;
+    if (func != TRY_UNWRAP(search_strp("goto"_s), abort())->val)
+        return false;
+    size_t dest = 0;
+    dest |= static_cast<uint8_t>(script_buf[pos_ + 6]) << 0;
+    dest |= static_cast<uint8_t>(script_buf[pos_ + 7]) << 8;
+    dest |= static_cast<uint8_t>(script_buf[pos_ + 8]) << 16;
+    *target = dest;
+    return true;
+}
+
+/*==========================================
+ * Retarget every label reference that lands on a "goto" line
+ * (as left behind by menus and if/goto chains) to its final
+ * destination.  Nothing is moved, so no positions change.
+ *------------------------------------------
+ */
+void ScriptBuffer::thread_jumps()
+{
+    size_t i = 0;
+    while (i < script_buf.size())
+    {
+        ByteCode c = script_buf[i];
+        if (static_cast<uint8_t>(c) >= 0x80)
+        {
+            while (static_cast<uint8_t>(script_buf[i]) >= 0xc0)
+                i++;
+            i++;
+            continue;
+        }
+        switch (c)
+        {
+            case ByteCode::POS:
+            {
+                size_t dest = 0;
+                dest |= static_cast<uint8_t>(script_buf[i + 1]) << 0;
+                dest |= static_cast<uint8_t>(script_buf[i + 2]) << 8;
+                dest |= static_cast<uint8_t>(script_buf[i + 3]) << 16;
+                size_t final_dest = dest;
+                // bounded, in case of "L: goto L;"
+                for (int hops = 0; hops < 16; hops++)
+                    if (!read_goto(final_dest, &final_dest))
+                        break;
+                if (final_dest != dest)
+                {
+                    script_buf[i + 1] = static_cast<ByteCode>(final_dest);
+                    script_buf[i + 2] = static_cast<ByteCode>(final_dest >> 8);
+                    script_buf[i + 3] = static_cast<ByteCode>(final_dest >> 16);
+                    script_threaded++;
+                }
+            }
+                i += 4;
+                break;
+            case ByteCode::VARIABLE:
+            case ByteCode::FUNC_REF:
+            case ByteCode::PARAM:
+                i += 4;
+                break;
+            case ByteCode::STR:
+                i++;
+                while (static_cast<uint8_t>(script_buf[i]) != 0)
+                    i++;
+                i++;
+                break;
+            default:
+                i++;
+                break;
+        }
+    }
+}
+
 /*==========================================
  * スペース/コメント読み飛ばし
  *------------------------------------------
@@ -458,11 +672,13 @@ ZString::iterator ScriptBuffer::parse_subexpr(ZString::iterator p, int limit)
         }
     }
     ZString::iterator tmpp = p;
+    size_t lhs = script_buf.size();
     if ((op = ByteCode::NEG, *p == '-') || (op = ByteCode::LNOT, *p == '!')
         || (op = ByteCode::NOT, *p == '~'))
     {
         p = parse_subexpr(p + 1, 100);
-        add_scriptc(op);
+        if (!fold_op_1(lhs, op))
+            add_scriptc(op);
     }
     else
         p = parse_simpleexpr(p);
@@ -488,6 +704,7 @@ ZString::iterator ScriptBuffer::parse_subexpr(ZString::iterator p, int limit)
             (op = ByteCode::LT, opl = 2, len = 1, *p == '<')) && opl > limit)
     {
         p += len;
+        size_t rhs = script_buf.size();
         if (op == ByteCode::FUNC)
         {
             int i = 0;
@@ -553,7 +770,8 @@ ZString::iterator ScriptBuffer::parse_subexpr(ZString::iterator p, int limit)
         {
             p = parse_subexpr(p, opl);
         }
-        add_scriptc(op);
+        if (!fold_op_2(lhs, rhs, op))
+            add_scriptc(op);
         p = skip_space(p);
     }
     return p;                   /* return first untreated operator */
@@ -684,9 +902,13 @@ ZString::iterator ScriptBuffer::parse_line(ZString::iterator p, bool *can_step)
  * 組み込み関数の追加
  *------------------------------------------
  */
-static
 void add_builtin_functions(void)
 {
+    static int first = 1;
+
+    if (!first)
+        return;
+    first = 0;
     for (int i = 0; builtin_functions[i].func; i++)
     {
         P<str_data_t> n = add_strp(builtin_functions[i].name);
@@ -695,10 +917,101 @@ void add_builtin_functions(void)
     }
 }
 
+/*==========================================
+ * Save the result of parse_script() for script-cache
+ *------------------------------------------
+ */
+script_cache_entry ScriptBuffer::to_cache() const
+{
+    script_cache_entry rv;
+    rv.code = script_buf;
+    rv.labels = debug_labels;
+    size_t i = 0;
+    while (i < script_buf.size())
+    {
+        ByteCode c = script_buf[i];
+        if (static_cast<uint8_t>(c) >= 0x80)
+        {
+            while (static_cast<uint8_t>(script_buf[i]) >= 0xc0)
+                i++;
+            i++;
+            continue;
+        }
+        switch (c)
+        {
+            case ByteCode::VARIABLE:
+            {
+                size_t pool_index = 0;
+                pool_index |= static_cast<uint8_t>(script_buf[i + 1]) << 0;
+                pool_index |= static_cast<uint8_t>(script_buf[i + 2]) << 8;
+                pool_index |= static_cast<uint8_t>(script_buf[i + 3]) << 16;
+                rv.variables.push_back(std::make_pair(i + 1,
+                            RString(variable_names.outtern(pool_index))));
+            }
+                i += 4;
+                break;
+            case ByteCode::POS:
+            case ByteCode::FUNC_REF:
+            case ByteCode::PARAM:
+                i += 4;
+                break;
+            case ByteCode::STR:
+                i++;
+                while (static_cast<uint8_t>(script_buf[i]) != 0)
+                    i++;
+                i++;
+                break;
+            default:
+                i++;
+                break;
+        }
+    }
+    return rv;
+}
+
+/*==========================================
+ * Redo the side effects of parse_script() from script-cache
+ *------------------------------------------
+ */
+void ScriptBuffer::from_cache(const script_cache_entry& entry)
+{
+    script_buf = entry.code;
+    debug_labels = entry.labels;
+    for (const auto& var : entry.variables)
+    {
+        size_t pool_index = variable_names.intern(var.second);
+        variable_scope(SIR::from(pool_index));
+        script_buf[var.first + 0] = static_cast<ByteCode>(pool_index);
+        script_buf[var.first + 1] = static_cast<ByteCode>(pool_index >> 8);
+        script_buf[var.first + 2] = static_cast<ByteCode>(pool_index >> 16);
+    }
+
+    scriptlabel_db.clear();
+    for (const auto& label : debug_labels)
+        scriptlabel_db.insert(label.first, label.second);
+}
+
 std::unique_ptr<const ScriptBuffer> compile_script(RString debug_name, const ast::script::ScriptBody& body, bool implicit_end)
 {
     auto script_buf = make_unique<ScriptBuffer>(std::move(debug_name));
+    if (!script_cache_ready)
+    {
+        script_buf->parse_script(body.braced_body, body.span.begin.line, implicit_end);
+        return std::move(script_buf);
+    }
+
+    uint64_t key = script_cache_key(body.braced_body, implicit_end);
+    OMATCH_BEGIN_SOME (entry, script_cache_find(key))
+    {
+        script_buf->from_cache(*entry);
+        return std::move(script_buf);
+    }
+    OMATCH_END ();
+
+    int errors = script_errors;
     script_buf->parse_script(body.braced_body, body.span.begin.line, implicit_end);
+    if (script_errors == errors)
+        script_cache_insert(key, script_buf->to_cache());
     return std::move(script_buf);
 }
 
@@ -708,13 +1021,7 @@ std::unique_ptr<const ScriptBuffer> compile_script(RString debug_name, const ast
  */
 void ScriptBuffer::parse_script(ZString src, int line, bool implicit_end)
 {
-    static int first = 1;
-
-    if (first)
-    {
-        add_builtin_functions();
-    }
-    first = 0;
+    add_builtin_functions();
     LABEL_NEXTLINE_.type = StringCode::NOP;
     LABEL_NEXTLINE_.backpatch = -1;
     LABEL_NEXTLINE_.label_ = -1;
@@ -805,6 +1112,8 @@ void ScriptBuffer::parse_script(ZString src, int line, bool implicit_end)
             sit.type = StringCode::VARIABLE;
             sit.label_ = 0; // anything but -1. Shouldn't matter, but helps asserts.
             size_t pool_index = variable_names.intern(sit.strs);
+            // resolve the scope now rather than on first access
+            variable_scope(SIR::from(pool_index));
             for (int next, j = sit.backpatch; j >= 0 && j != 0x00ffffff; j = next)
             {
                 next = 0;
@@ -818,6 +1127,8 @@ void ScriptBuffer::parse_script(ZString src, int line, bool implicit_end)
         }
     }
 
+    thread_jumps();
+
     for (const auto& pair : scriptlabel_db)
     {
         ScriptLabel key = pair.first;
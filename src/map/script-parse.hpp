@@ -32,5 +32,7 @@ namespace tmwa
 namespace map
 {
 std::unique_ptr<const ScriptBuffer> compile_script(RString debug_name, const ast::script::ScriptBody& body, bool implicit_end);
+RString script_debug_name(Borrowed<const ScriptBuffer> code);
+ScriptLabel script_debug_label(Borrowed<const ScriptBuffer> code, size_t pos);
 } // namespace map
 } // namespace tmwa
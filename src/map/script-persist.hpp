@@ -22,10 +22,15 @@
 
 #include "fwd.hpp"
 
+#include <algorithm>
+#include <vector>
+
 #include "../compat/borrow.hpp"
 
 #include "../strings/rstring.hpp"
 
+#include "../generic/db.hpp"
+
 #include "../sexpr/variant.hpp"
 
 #include "../mmo/clif.t.hpp"
@@ -61,6 +66,71 @@ public:
     friend bool operator < (SIR l, SIR r) { return l.impl < r.impl; }
 };
 
+/// Script variables, with each array kept contiguous by base name so
+/// that the array builtins don't do a tree lookup per element.
+/// As with DMap, storing V() is the same as erasing.
+template<class V>
+class SIRMap
+{
+    // never has trailing V()s, so size() is the array size
+    Map<unsigned, std::vector<V>> arrays;
+public:
+    Option<Borrowed<V>> search(SIR k)
+    {
+        P<std::vector<V>> arr = TRY_UNWRAP(arrays.search(k.base()), return None);
+        if (k.index() >= arr->size() || (*arr)[k.index()] == V())
+            return None;
+        return Some(borrow((*arr)[k.index()]));
+    }
+    V get(SIR k)
+    {
+        P<V> v = TRY_UNWRAP(search(k), return V());
+        return *v;
+    }
+    void put(SIR k, V v)
+    {
+        if (v == V())
+        {
+            clear_array(k, 1);
+            return;
+        }
+        P<std::vector<V>> arr = arrays.init(k.base());
+        if (k.index() >= arr->size())
+            arr->resize(k.index() + 1);
+        (*arr)[k.index()] = std::move(v);
+    }
+    /// One past the last set element of the array k is in.
+    size_t array_size(SIR k)
+    {
+        P<std::vector<V>> arr = TRY_UNWRAP(arrays.search(k.base()), return 0);
+        return arr->size();
+    }
+    /// Erase n elements, starting at k.
+    void clear_array(SIR k, size_t n)
+    {
+        P<std::vector<V>> arr = TRY_UNWRAP(arrays.search(k.base()), return);
+        size_t end = std::min(arr->size(), k.index() + n);
+        for (size_t i = k.index(); i < end; ++i)
+            (*arr)[i] = V();
+        while (!arr->empty() && arr->back() == V())
+            arr->pop_back();
+        if (arr->empty())
+            arrays.erase(k.base());
+    }
+    void clear()
+    {
+        arrays.clear();
+    }
+    template<class F>
+    void for_each(F f)
+    {
+        for (auto& pair : arrays)
+            for (size_t i = 0; i < pair.second.size(); ++i)
+                if (!(pair.second[i] == V()))
+                    f(SIR::from(pair.first, i), pair.second[i]);
+    }
+};
+
 struct ScriptDataPos
 {
     int numi;
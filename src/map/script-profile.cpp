@@ -0,0 +1,119 @@
+#include "script-profile.hpp"
+//    script-profile.cpp - Optional accounting of where scripts spend their time.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "../strings/zstring.hpp"
+
+#include "../generic/db.hpp"
+
+#include "../io/cxxstdio.hpp"
+
+#include "../mmo/strs.hpp"
+
+#include "globals.hpp"
+#include "script-fun.hpp"
+#include "script-parse.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+// While script_profiling is set, run_script_main() charges its
+// instructions and wall-clock time to the label it was entered at (or the
+// user function it called into), and run_func() charges each builtin.
+// Nothing here is looked at otherwise.
+
+Borrowed<script_profile> script_profile_for(Borrowed<const ScriptBuffer> code, size_t pos)
+{
+    AString name = STRPRINTF("%s::%s"_fmt,
+            script_debug_name(code), script_debug_label(code, pos));
+    Borrowed<script_profile> rv = script_profile_db.init(name);
+    if (!rv->name)
+        rv->name = name;
+    return rv;
+}
+
+void script_profile_builtin(size_t func, profile_clock::duration elapsed)
+{
+    if (func >= builtin_profile_db.size())
+        builtin_profile_db.resize(func + 1);
+    builtin_profile_db[func].calls++;
+    builtin_profile_db[func].elapsed += elapsed;
+}
+
+void script_profile_reset(void)
+{
+    script_profile_db.clear();
+    builtin_profile_db.clear();
+}
+
+static
+long profile_us(profile_clock::duration elapsed)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+std::vector<AString> script_profile_report(bool builtins, size_t count)
+{
+    std::vector<AString> rv;
+    if (builtins)
+    {
+        std::vector<size_t> order;
+        for (size_t i = 0; i < builtin_profile_db.size(); ++i)
+            if (builtin_profile_db[i].calls)
+                order.push_back(i);
+        std::sort(order.begin(), order.end(),
+                [](size_t l, size_t r)
+                {
+                    return builtin_profile_db[l].elapsed > builtin_profile_db[r].elapsed;
+                }
+        );
+        if (order.size() > count)
+            order.resize(count);
+        for (size_t i : order)
+            rv.push_back(STRPRINTF("%8ldus %8d calls  %s"_fmt,
+                        profile_us(builtin_profile_db[i].elapsed),
+                        builtin_profile_db[i].calls,
+                        builtin_functions[i].name));
+        return rv;
+    }
+
+    std::vector<const script_profile *> order;
+    for (auto& pair : script_profile_db)
+        order.push_back(&pair.second);
+    std::sort(order.begin(), order.end(),
+            [](const script_profile *l, const script_profile *r)
+            {
+                return l->elapsed > r->elapsed;
+            }
+    );
+    if (order.size() > count)
+        order.resize(count);
+    for (const script_profile *p : order)
+        rv.push_back(STRPRINTF("%8ldus %8ld insns %6d runs  %s"_fmt,
+                    profile_us(p->elapsed), p->instructions, p->entries, p->name));
+    return rv;
+}
+} // namespace map
+} // namespace tmwa
@@ -0,0 +1,59 @@
+#pragma once
+//    script-profile.hpp - Optional accounting of where scripts spend time.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include "../strings/astring.hpp"
+#include "../strings/rstring.hpp"
+
+#include "script-buffer.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+using profile_clock = std::chrono::steady_clock;
+
+/// Everything run from one label of one npc or function.
+struct script_profile
+{
+    RString name;
+    int entries;
+    long instructions;
+    profile_clock::duration elapsed;
+};
+
+struct builtin_profile
+{
+    int calls;
+    profile_clock::duration elapsed;
+};
+
+Borrowed<script_profile> script_profile_for(Borrowed<const ScriptBuffer> code, size_t pos);
+void script_profile_builtin(size_t func, profile_clock::duration elapsed);
+void script_profile_reset(void);
+/// The count most expensive labels (or builtins), most expensive first.
+std::vector<AString> script_profile_report(bool builtins, size_t count);
+} // namespace map
+} // namespace tmwa
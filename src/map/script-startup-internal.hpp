@@ -32,5 +32,7 @@ namespace map
 {
 void mapreg_setreg(SIR reg, int val);
 void mapreg_setregstr(SIR reg, XString str);
+void mapreg_clearreg(SIR reg, int n);
+void mapreg_clearregstr(SIR reg, int n);
 } // namespace map
 } // namespace tmwa
@@ -22,6 +22,8 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+
 #include "../strings/zstring.hpp"
 
 #include "../generic/db.hpp"
@@ -37,6 +39,7 @@
 #include "globals.hpp"
 #include "map.hpp"
 #include "map_conf.hpp"
+#include "script-call-internal.hpp"
 #include "script-parse-internal.hpp"
 #include "script-persist.hpp"
 
@@ -48,6 +51,7 @@ namespace tmwa
 namespace map
 {
 constexpr std::chrono::milliseconds MAPREG_AUTOSAVE_INTERVAL = 10_s;
+constexpr size_t MAPREG_COMPACT_LINES = 4096;
 
 bool read_constdb(ZString filename)
 {
@@ -116,6 +120,22 @@ void mapreg_setreg(SIR reg, int val)
 {
     mapreg_db.put(reg, val);
 
+    mapreg_dirty = 1;
+    mapreg_dirty_keys.insert(reg);
+}
+
+static
+void mapreg_dirty_range(SIR reg, size_t size, int n)
+{
+    for (size_t i = reg.index(); i < size && i < reg.index() + n; ++i)
+        mapreg_dirty_keys.insert(SIR::from(reg.base(), i));
+}
+
+void mapreg_clearreg(SIR reg, int n)
+{
+    mapreg_dirty_range(reg, mapreg_db.array_size(reg), n);
+    mapreg_db.clear_array(reg, n);
+
     mapreg_dirty = 1;
 }
 
@@ -125,10 +145,16 @@ void mapreg_setreg(SIR reg, int val)
  */
 void mapreg_setregstr(SIR reg, XString str)
 {
-    if (!str)
-        mapregstr_db.erase(reg);
-    else
-        mapregstr_db.insert(reg, str);
+    mapregstr_db.put(reg, str);
+
+    mapreg_dirty = 1;
+    mapreg_dirty_keys.insert(reg);
+}
+
+void mapreg_clearregstr(SIR reg, int n)
+{
+    mapreg_dirty_range(reg, mapregstr_db.array_size(reg), n);
+    mapregstr_db.clear_array(reg, n);
 
     mapreg_dirty = 1;
 }
@@ -148,6 +174,7 @@ void script_load_mapreg(void)
     AString line;
     while (in.getline(line))
     {
+        mapreg_journal_lines++;
         XString buf1, buf2;
         int index = 0;
         if (extract(line,
@@ -163,7 +190,7 @@ void script_load_mapreg(void)
             SIR key = SIR::from(s, index);
             if (buf1.back() == '$')
             {
-                mapregstr_db.insert(key, buf2);
+                mapregstr_db.put(key, buf2);
             }
             else
             {
@@ -221,18 +248,59 @@ void script_save_mapreg(void)
     io::WriteLock fp(map_conf.mapreg_txt);
     if (!fp.is_open())
         return;
-    for (auto& pair : mapreg_db)
-        script_save_mapreg_intsub(pair.first, pair.second, fp);
-    for (auto& pair : mapregstr_db)
-        script_save_mapreg_strsub(pair.first, pair.second, fp);
+    mapreg_saved_lines = 0;
+    mapreg_db.for_each([&fp](SIR key, int data)
+            {
+                script_save_mapreg_intsub(key, data, fp);
+                mapreg_saved_lines++;
+            }
+    );
+    mapregstr_db.for_each([&fp](SIR key, ZString data)
+            {
+                script_save_mapreg_strsub(key, data, fp);
+                mapreg_saved_lines++;
+            }
+    );
+    mapreg_journal_lines = 0;
+    mapreg_dirty_keys.clear();
+    mapreg_dirty = 0;
+}
+
+/*==========================================
+ * Append just the variables changed since the last save.
+ * Later lines override earlier ones when loading, and a
+ * cleared variable is written with an empty value.
+ *------------------------------------------
+ */
+static
+void script_append_mapreg(void)
+{
+    io::AppendFile fp(map_conf.mapreg_txt);
+    if (!fp.is_open())
+        return;
+    for (SIR key : mapreg_dirty_keys)
+    {
+        if (variable_names.outtern(key.base()).back() == '$')
+            script_save_mapreg_strsub(key, mapregstr_db.get(key), fp);
+        else
+            script_save_mapreg_intsub(key, mapreg_db.get(key), fp);
+    }
+    mapreg_journal_lines += mapreg_dirty_keys.size();
+    mapreg_dirty_keys.clear();
     mapreg_dirty = 0;
 }
 
 static
 void script_autosave_mapreg(TimerData *, tick_t)
 {
-    if (mapreg_dirty)
+    if (!mapreg_dirty)
+        return;
+    // once the appended changes outweigh the live data, start over
+    if (mapreg_journal_lines + mapreg_dirty_keys.size()
+            > std::max<size_t>(MAPREG_COMPACT_LINES, mapreg_saved_lines))
         script_save_mapreg();
+    else
+        script_append_mapreg();
 }
 
 void do_final_script(void)
@@ -240,6 +308,8 @@ void do_final_script(void)
     if (mapreg_dirty >= 0)
         script_save_mapreg();
 
+    script_run_timer.cancel();
+    script_run_queue.clear();
     mapreg_db.clear();
     mapregstr_db.clear();
     scriptlabel_db.clear();
@@ -0,0 +1,139 @@
+#include "walk.hpp"
+//    walk.cpp - Batched movement of players and mobs.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "../compat/nullpo.hpp"
+
+#include "../net/timer.hpp"
+
+#include "globals.hpp"
+#include "map.hpp"
+
+#include "../poison.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+// Every walking PC and mob used to own a Timer that was re-armed on
+// each half-step, so a busy map pushed thousands of heap-allocated
+// TimerData (each with a std::function) per second through the global
+// timer heap. Instead, the pending steps live by value in walk_queue,
+// and a single Timer is armed for the earliest of them.
+//
+// Packets sent while delivering a batch are appended to each observer's
+// session buffer, and are flushed together by the next do_sendrecv().
+
+static
+bool walk_later(const walk_entry& l, const walk_entry& r)
+{
+    // std::push_heap builds a max-heap, but we want a min-heap.
+    return l.tick > r.tick;
+}
+
+static
+WalkStep *walk_step_of(dumb_ptr<block_list> bl)
+{
+    switch (bl->bl_type)
+    {
+        case BL::PC:
+            return &bl->is_player()->walktimer;
+        case BL::MOB:
+            return &bl->is_mob()->walktimer;
+        default:
+            return nullptr;
+    }
+}
+
+static
+void walk_timer_func(TimerData *, tick_t tick)
+{
+    walk_deliver(tick);
+}
+
+static
+void walk_arm_timer(void)
+{
+    if (walk_queue.empty())
+        return;
+    tick_t next = walk_queue.front().tick;
+    if (walk_timer && walk_timer_tick <= next)
+        return;
+    walk_timer_tick = next;
+    walk_timer = Timer(next, walk_timer_func);
+}
+
+void walk_schedule(dumb_ptr<block_list> bl, tick_t tick,
+        walk_func func, unsigned char data)
+{
+    nullpo_retv(bl);
+    WalkStep *step = walk_step_of(bl);
+    assert (step);
+
+    if (!++walk_serial)
+        ++walk_serial;
+    step->serial = walk_serial;
+
+    walk_queue.push_back(walk_entry{tick, bl->bl_id, walk_serial, func, data});
+    std::push_heap(walk_queue.begin(), walk_queue.end(), walk_later);
+    walk_arm_timer();
+}
+
+void walk_deliver(tick_t tick)
+{
+    walk_timer.cancel();
+
+    MapBlockLock lock;
+    while (!walk_queue.empty() && walk_queue.front().tick <= tick)
+    {
+        // Take the whole batch that is due now, so that steps which are
+        // rescheduled while it runs (even for this same tick) go into
+        // the next pass instead of invalidating our iteration.
+        walk_batch.clear();
+        while (!walk_queue.empty() && walk_queue.front().tick <= tick)
+        {
+            std::pop_heap(walk_queue.begin(), walk_queue.end(), walk_later);
+            walk_batch.push_back(walk_queue.back());
+            walk_queue.pop_back();
+        }
+
+        for (const walk_entry& we : walk_batch)
+        {
+            dumb_ptr<block_list> bl = map_id2bl(we.id);
+            if (bl == nullptr)
+                continue;
+            WalkStep *step = walk_step_of(bl);
+            if (!step || step->serial != we.serial)
+                continue;
+            step->serial = 0;
+            // same lag compensation as do_timer()
+            we.func(bl, we.tick + 1_s < tick ? tick : we.tick, we.data);
+        }
+    }
+
+    walk_timer.cancel();
+    walk_arm_timer();
+}
+} // namespace map
+} // namespace tmwa
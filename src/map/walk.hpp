@@ -0,0 +1,37 @@
+#pragma once
+//    walk.hpp - Batched movement of players and mobs.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "walk.t.hpp"
+
+#include "fwd.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+/// Queue the next half-step of a walking PC or mob.
+/// Replaces any step that is already pending for the same block.
+void walk_schedule(dumb_ptr<block_list> bl, tick_t tick,
+        walk_func func, unsigned char data);
+/// Run every step that is due at or before tick, in one batch.
+void walk_deliver(tick_t tick);
+} // namespace map
+} // namespace tmwa
@@ -0,0 +1,75 @@
+#pragma once
+//    walk.t.hpp - Batched movement of players and mobs.
+//
+//    Copyright © 2026 The Mana World Development Team
+//
+//    This file is part of The Mana World (Athena server)
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "fwd.hpp"
+
+#include <cstdint>
+
+#include "../generic/dumb_ptr.hpp"
+
+#include "../net/timer.t.hpp"
+
+#include "../mmo/ids.hpp"
+
+
+namespace tmwa
+{
+namespace map
+{
+/// Called when a queued half-step is due.
+typedef void (*walk_func)(dumb_ptr<block_list> bl, tick_t tick, unsigned char data);
+
+/// A block's slot in the walk queue.
+///
+/// This behaves like a Timer that can only be armed by walk_schedule():
+/// it is truthy while a step is pending, and it is cleared just before
+/// the step is delivered. Cancelling is O(1); the stale queue entry is
+/// discarded when it comes due.
+class WalkStep
+{
+    friend void walk_schedule(dumb_ptr<block_list> bl, tick_t tick,
+            walk_func func, unsigned char data);
+    friend void walk_deliver(tick_t tick);
+
+    uint32_t serial = 0;
+
+    WalkStep(const WalkStep&) = delete;
+    WalkStep& operator = (const WalkStep&) = delete;
+public:
+    WalkStep() = default;
+    ~WalkStep() { cancel(); }
+
+    void cancel() { serial = 0; }
+
+    explicit operator bool() { return serial; }
+    bool operator !() { return !serial; }
+};
+
+/// One pending half-step, stored by value in the walk queue.
+struct walk_entry
+{
+    tick_t tick;
+    BlockId id;
+    uint32_t serial;
+    walk_func func;
+    unsigned char data;
+};
+} // namespace map
+} // namespace tmwa
@@ -23,6 +23,7 @@
 #include "fwd.hpp"
 
 #include "../strings/vstring.hpp"
+#include "../strings/xstring.hpp"
 
 
 namespace tmwa
@@ -113,6 +114,8 @@ public:
     { return l.to__canonical() > r.to__canonical(); }
     friend bool operator >= (const CharName& l, const CharName& r)
     { return l.to__canonical() >= r.to__canonical(); }
+    friend size_t hash_key(const CharName& n)
+    { return hash_key(XString(n.to__canonical())); }
 
     friend
     VString<23> convert_for_printf(const CharName& vs) { return vs.to__actual(); }
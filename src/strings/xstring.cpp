@@ -77,5 +77,20 @@ namespace strings
     {
         return _base;
     }
+
+    uint64_t fnv1a(uint64_t h, XString s)
+    {
+        for (char c : s)
+        {
+            h ^= static_cast<uint8_t>(c);
+            h *= 0x100000001b3;
+        }
+        return h;
+    }
+
+    size_t hash_key(XString s)
+    {
+        return fnv1a(FNV1A_BASIS, s);
+    }
 } // namespace strings
 } // namespace tmwa
@@ -56,6 +56,12 @@ namespace strings
         iterator end() const;
         const RString *base() const;
     };
+
+    constexpr uint64_t FNV1A_BASIS = 0xcbf29ce484222325;
+    /// Continue an FNV-1a hash, started from FNV1A_BASIS, over s.
+    uint64_t fnv1a(uint64_t h, XString s);
+    /// For HashMap; any string type can be hashed through this.
+    size_t hash_key(XString s);
 } // namespace strings
 } // namespace tmwa
 
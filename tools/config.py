@@ -512,6 +512,7 @@ def build_config():
     login_conf.opt('new_account', bool, 'false')
     login_conf.opt('login_port', u16, '6901', min='1024')
     login_conf.opt('account_filename', RString, lit('save/account.txt'))
+    login_conf.opt('account_bin', RString, '{}')
     login_conf.opt('gm_account_filename', RString, lit('save/gm_account.txt'))
     login_conf.opt('gm_account_filename_check_timer', seconds, '15_s')
     login_conf.opt('login_log_filename', RString, lit('log/login.log'))
@@ -547,6 +548,7 @@ def build_config():
     char_conf.opt('char_ip', IP4Address, '{}')
     char_conf.opt('char_port', u16, '6121', min='1024')
     char_conf.opt('char_txt', RString, '{}')
+    char_conf.opt('char_bin', RString, '{}')
     char_conf.opt('max_connect_user', u32, '0')
     char_conf.opt('autosave_time', seconds, 'DEFAULT_AUTOSAVE_INTERVAL', {char_h}, min='1_s')
     char_conf.opt('start_point', Point, '{ {"001-1.gat"_s}, 273, 354 }')
@@ -561,6 +563,7 @@ def build_config():
     char_conf.opt('anti_freeze_interval', seconds, '6_s', min='5_s')
 
     inter_conf.opt('storage_txt', RString, lit('save/storage.txt'))
+    inter_conf.opt('storage_bin', RString, '{}')
     inter_conf.opt('party_txt', RString, lit('save/party.txt'))
     inter_conf.opt('accreg_txt', RString, lit('save/accreg.txt'))
     inter_conf.opt('party_share_level', u32, '10')
@@ -578,6 +581,7 @@ def build_config():
     map_conf.opt('autosave_time', seconds, 'DEFAULT_AUTOSAVE_INTERVAL', {map_h})
     map_conf.opt('motd_txt', RString, lit('conf/motd.txt'))
     map_conf.opt('mapreg_txt', RString, lit('save/mapreg.txt'))
+    map_conf.opt('script_cache', RString, '{}')
     map_conf.opt('gm_log', RString, '{}')
     map_conf.opt('log_file', RString, '{}')
 